@@ -0,0 +1,1038 @@
+// PixRaw 基准测试
+//
+// 用法：
+//   pixraw_bench [--corpus DIR] [--iterations N] [--width W] [--height H]
+//                [--filter SUBSTR] [--json FILE]
+//
+// 默认在进程内生成一张合成 CFA（Bayer RGGB）DNG，覆盖打开、元数据、缩略图、签名、
+// 目录导入（逐个打开与预取对比）、各解码档位、各调整阶段（AoS 与 SoA、逐阶段与
+// 融合内核对比）、色彩 LUT、输出版本（融合缩小/锐化/打包与分步实现对比）、resize 和 convertTo；
+// 另生成一张同尺寸的合成压缩 IIQ，对比 LibRaw 单线程解码器与并行解包，并逐字节校验两者的 RAW 数据。
+// 指定 --corpus 时，额外对目录下的每个 RAW 文件运行文件相关的基准，并对整个目录运行导入基准。
+// 结果以 JSON 输出（每项含平均/最小耗时 ms 和 MP/s），便于回归跟踪。
+
+#include <ColorManagement.h>
+#include <ImageAdjuster.h>
+#include <ImageSignature.h>
+#include <HalfPlanarImage.h>
+#include <PixRaw.h>
+#include <PlanarImage.h>
+#include <Prefetch.h>
+#include <RawImage.h>
+#include <Rendition.h>
+#include "ParallelLibRaw.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace PixRaw;
+
+namespace {
+
+// === 计时 ===
+
+struct BenchResult {
+    std::string name;
+    std::string source;
+    int iterations = 0;
+    double mean_ms = 0.0;
+    double min_ms = 0.0;
+    double megapixels = 0.0;
+};
+
+volatile uint8_t g_sink = 0;
+
+void consume(const RawImage& image) {
+    if (image.isValid()) g_sink = g_sink ^ image.data()[0];
+}
+
+void consume(const PlanarImage& image) {
+    if (image.isValid()) g_sink = g_sink ^ static_cast<uint8_t>(image.plane(0)[0] * 255.0f);
+}
+
+class BenchRunner {
+public:
+    BenchRunner(int iterations, std::string filter)
+        : iterations_(std::max(iterations, 1)), filter_(std::move(filter)) {}
+
+    bool selected(const std::string& name) const {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    // setup 不计时，body 计时；每次迭代都先调用 setup
+    void run(const std::string& name, const std::string& source, double megapixels,
+             const std::function<void()>& setup, const std::function<void()>& body) {
+        if (!selected(name)) {
+            return;
+        }
+
+        BenchResult result;
+        result.name = name;
+        result.source = source;
+        result.iterations = iterations_;
+        result.megapixels = megapixels;
+        result.min_ms = 1e300;
+
+        double total = 0.0;
+        for (int i = 0; i < iterations_; ++i) {
+            if (setup) setup();
+            auto start = std::chrono::steady_clock::now();
+            body();
+            auto end = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            total += ms;
+            result.min_ms = std::min(result.min_ms, ms);
+        }
+        result.mean_ms = total / iterations_;
+
+        std::fprintf(stderr, "%-36s %-24s %10.2f ms %10.1f MP/s\n", name.c_str(), source.c_str(),
+                     result.mean_ms, mpPerSecond(result));
+        results_.push_back(result);
+    }
+
+    void run(const std::string& name, const std::string& source, double megapixels,
+             const std::function<void()>& body) {
+        run(name, source, megapixels, nullptr, body);
+    }
+
+    void writeJson(std::ostream& out, int width, int height) const {
+        out << "{\n";
+        out << "  \"context\": {\"iterations\": " << iterations_ << ", \"synthetic_width\": " << width
+            << ", \"synthetic_height\": " << height << "},\n";
+        out << "  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            const BenchResult& r = results_[i];
+            out << "    {\"name\": \"" << escape(r.name) << "\", \"source\": \"" << escape(r.source)
+                << "\", \"iterations\": " << r.iterations << ", \"mean_ms\": " << r.mean_ms
+                << ", \"min_ms\": " << r.min_ms << ", \"megapixels\": " << r.megapixels
+                << ", \"mp_per_s\": " << mpPerSecond(r) << "}" << (i + 1 < results_.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+private:
+    static double mpPerSecond(const BenchResult& r) {
+        return r.mean_ms > 0.0 ? r.megapixels / (r.mean_ms / 1000.0) : 0.0;
+    }
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) < 0x20) continue;
+            out += c;
+        }
+        return out;
+    }
+
+    int iterations_;
+    std::string filter_;
+    std::vector<BenchResult> results_;
+};
+
+// === 合成数据 ===
+
+// 合成场景：平滑渐变叠加细节纹理，取值 [0, 1]
+void sceneColor(int x, int y, int width, int height, float rgb[3]) {
+    float u = static_cast<float>(x) / width;
+    float v = static_cast<float>(y) / height;
+    float detail = 0.1f * std::sin(x * 0.37f) * std::sin(y * 0.23f);
+    rgb[0] = std::min(std::max(0.15f + 0.7f * u + detail, 0.0f), 1.0f);
+    rgb[1] = std::min(std::max(0.15f + 0.7f * v + detail, 0.0f), 1.0f);
+    rgb[2] = std::min(std::max(0.85f - 0.7f * u + detail, 0.0f), 1.0f);
+}
+
+class TiffWriter {
+public:
+    struct Entry {
+        uint16_t tag;
+        uint16_t type;
+        uint32_t count;
+        std::vector<uint8_t> payload;
+    };
+
+    void addShort(uint16_t tag, std::vector<uint16_t> values) {
+        std::vector<uint8_t> p;
+        for (uint16_t v : values) append16(p, v);
+        entries_.push_back({tag, 3, static_cast<uint32_t>(values.size()), p});
+    }
+
+    void addLong(uint16_t tag, std::vector<uint32_t> values) {
+        std::vector<uint8_t> p;
+        for (uint32_t v : values) append32(p, v);
+        entries_.push_back({tag, 4, static_cast<uint32_t>(values.size()), p});
+    }
+
+    void addByte(uint16_t tag, std::vector<uint8_t> values) {
+        entries_.push_back({tag, 1, static_cast<uint32_t>(values.size()), values});
+    }
+
+    void addAscii(uint16_t tag, const std::string& value) {
+        std::vector<uint8_t> p(value.begin(), value.end());
+        p.push_back(0);
+        entries_.push_back({tag, 2, static_cast<uint32_t>(p.size()), p});
+    }
+
+    void addRational(uint16_t tag, std::vector<double> values, bool is_signed) {
+        std::vector<uint8_t> p;
+        for (double v : values) {
+            append32(p, static_cast<uint32_t>(static_cast<int32_t>(std::lround(v * 10000.0))));
+            append32(p, 10000);
+        }
+        entries_.push_back({tag, static_cast<uint16_t>(is_signed ? 10 : 5), static_cast<uint32_t>(values.size()), p});
+    }
+
+    // 写出单 IFD 的小端 TIFF，image_offset_tag 的值会被回填为像素数据偏移
+    std::vector<uint8_t> write(uint16_t image_offset_tag, const std::vector<uint8_t>& pixels) {
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) { return a.tag < b.tag; });
+
+        const uint32_t ifd_offset = 8;
+        const uint32_t ifd_size = 2 + 12 * static_cast<uint32_t>(entries_.size()) + 4;
+        uint32_t extra_offset = ifd_offset + ifd_size;
+
+        uint32_t extra_size = 0;
+        for (const Entry& e : entries_) {
+            if (e.payload.size() > 4) extra_size += static_cast<uint32_t>((e.payload.size() + 1) & ~size_t(1));
+        }
+        uint32_t pixel_offset = (extra_offset + extra_size + 15) & ~uint32_t(15);
+
+        std::vector<uint8_t> out;
+        out.reserve(pixel_offset + pixels.size());
+        out.push_back('I');
+        out.push_back('I');
+        append16(out, 42);
+        append32(out, ifd_offset);
+
+        append16(out, static_cast<uint16_t>(entries_.size()));
+        std::vector<uint8_t> extra;
+        for (Entry& e : entries_) {
+            if (e.tag == image_offset_tag) {
+                e.payload.clear();
+                append32(e.payload, pixel_offset);
+            }
+            append16(out, e.tag);
+            append16(out, e.type);
+            append32(out, e.count);
+            if (e.payload.size() <= 4) {
+                std::vector<uint8_t> inline_value = e.payload;
+                inline_value.resize(4, 0);
+                out.insert(out.end(), inline_value.begin(), inline_value.end());
+            } else {
+                append32(out, extra_offset + static_cast<uint32_t>(extra.size()));
+                extra.insert(extra.end(), e.payload.begin(), e.payload.end());
+                if (extra.size() & 1) extra.push_back(0);
+            }
+        }
+        append32(out, 0);  // 无后续 IFD
+        out.insert(out.end(), extra.begin(), extra.end());
+        out.resize(pixel_offset, 0);
+        out.insert(out.end(), pixels.begin(), pixels.end());
+        return out;
+    }
+
+private:
+    static void append16(std::vector<uint8_t>& v, uint16_t x) {
+        v.push_back(static_cast<uint8_t>(x & 0xFF));
+        v.push_back(static_cast<uint8_t>(x >> 8));
+    }
+
+    static void append32(std::vector<uint8_t>& v, uint32_t x) {
+        for (int i = 0; i < 4; ++i) v.push_back(static_cast<uint8_t>((x >> (i * 8)) & 0xFF));
+    }
+
+    std::vector<Entry> entries_;
+};
+
+/**
+ * 生成未压缩 16 位 Bayer RGGB DNG
+ *
+ * ColorMatrix1 取 XYZ -> 线性 sRGB，使相机空间等同 sRGB；
+ * 像素按 AsShotNeutral 缩放，模拟未白平衡的传感器数据。
+ */
+std::vector<uint8_t> makeSyntheticDng(int width, int height) {
+    const uint32_t black = 512;
+    const uint32_t white = 16383;
+    const double neutral[3] = {0.5, 1.0, 0.6};
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 2);
+    uint32_t noise = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float rgb[3];
+            sceneColor(x, y, width, height, rgb);
+            int c = (y & 1) ? ((x & 1) ? 2 : 1) : ((x & 1) ? 1 : 0);
+            noise = noise * 1664525u + 1013904223u;
+            double value = black + rgb[c] * neutral[c] * (white - black) * 0.9 + ((noise >> 24) & 0x0F);
+            uint16_t v = static_cast<uint16_t>(std::min(value, static_cast<double>(white)));
+            size_t offset = (static_cast<size_t>(y) * width + x) * 2;
+            pixels[offset] = static_cast<uint8_t>(v & 0xFF);
+            pixels[offset + 1] = static_cast<uint8_t>(v >> 8);
+        }
+    }
+
+    TiffWriter tiff;
+    tiff.addLong(254, {0});                          // NewSubFileType
+    tiff.addLong(256, {static_cast<uint32_t>(width)});
+    tiff.addLong(257, {static_cast<uint32_t>(height)});
+    tiff.addShort(258, {16});                        // BitsPerSample
+    tiff.addShort(259, {1});                         // Compression: none
+    tiff.addShort(262, {32803});                     // Photometric: CFA
+    tiff.addAscii(271, "PixRaw");
+    tiff.addAscii(272, "Synthetic CFA");
+    tiff.addLong(273, {0});                          // StripOffsets（回填）
+    tiff.addShort(274, {1});                         // Orientation
+    tiff.addShort(277, {1});                         // SamplesPerPixel
+    tiff.addLong(278, {static_cast<uint32_t>(height)});
+    tiff.addLong(279, {static_cast<uint32_t>(pixels.size())});
+    tiff.addShort(284, {1});                         // PlanarConfiguration
+    tiff.addShort(33421, {2, 2});                    // CFARepeatPatternDim
+    tiff.addByte(33422, {0, 1, 1, 2});               // CFAPattern: RGGB
+    tiff.addByte(50706, {1, 4, 0, 0});               // DNGVersion
+    tiff.addAscii(50708, "PixRaw Synthetic CFA");    // UniqueCameraModel
+    tiff.addLong(50714, {black});                    // BlackLevel
+    tiff.addLong(50717, {white});                    // WhiteLevel
+    tiff.addRational(50721, {3.2406, -1.5372, -0.4986,
+                             -0.9689, 1.8758, 0.0415,
+                             0.0557, -0.2040, 1.0570}, true);  // ColorMatrix1
+    tiff.addRational(50728, {neutral[0], neutral[1], neutral[2]}, false);  // AsShotNeutral
+    tiff.addShort(50778, {21});                      // CalibrationIlluminant1: D65
+    return tiff.write(273, pixels);
+}
+
+// Phase One 压缩行编码（phase_one_load_raw_c 的逆过程）：位从高到低写入 32 位字，按小端存放
+class PhaseOneRowWriter {
+public:
+    explicit PhaseOneRowWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint32_t value, int bits) {
+        acc_ = acc_ << bits | value;
+        count_ += bits;
+        while (count_ >= 32) {
+            uint32_t word = static_cast<uint32_t>(acc_ >> (count_ - 32));
+            for (int i = 0; i < 4; ++i) out_.push_back(static_cast<uint8_t>((word >> (i * 8)) & 0xFF));
+            count_ -= 32;
+        }
+    }
+
+    void flush() {
+        if (count_ > 0) put(0, 32 - count_);
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int count_ = 0;
+};
+
+void encodePhaseOneRow(const uint16_t* row, int width, std::vector<uint8_t>& out) {
+    static const int kLength[] = {8, 7, 6, 9, 11, 10, 5, 12, 14, 13};
+    PhaseOneRowWriter writer(out);
+    int pred[2] = {0, 0};
+    const int packed = width & -8;
+    for (int group = 0; group < packed; group += 8) {
+        // 奇偶列各选能容纳本组 4 个差分的最短码长（14 表示存 16 位原值）
+        int len[2];
+        for (int parity = 0; parity < 2; ++parity) {
+            int index = 8;
+            for (int candidate = 0; candidate < 10; ++candidate) {
+                int bits = kLength[candidate];
+                if (bits >= kLength[index]) continue;
+                int p = pred[parity];
+                bool fits = true;
+                for (int col = group + parity; col < group + 8; col += 2) {
+                    int d = row[col] - p;
+                    fits = fits && d > -(1 << (bits - 1)) && d <= (1 << (bits - 1));
+                    p = row[col];
+                }
+                if (fits) index = candidate;
+            }
+            len[parity] = kLength[index];
+            int zeros = index / 2 + 1;
+            writer.put(0, zeros);
+            if (zeros < 5) writer.put(1, 1);
+            writer.put(static_cast<uint32_t>(index & 1), 1);
+        }
+        for (int col = group; col < group + 8; ++col) {
+            int parity = col & 1;
+            if (len[parity] == 14) {
+                writer.put(row[col], 16);
+            } else {
+                writer.put(static_cast<uint32_t>(row[col] - pred[parity] + (1 << (len[parity] - 1)) - 1), len[parity]);
+            }
+            pred[parity] = row[col];
+        }
+    }
+    for (int col = packed; col < width; ++col) writer.put(row[col], 16);
+    writer.flush();
+}
+
+/**
+ * 生成 Phase One 压缩 IIQ（14 位 Bayer，phase_one_load_raw_c 格式）
+ *
+ * 每行在行偏移表中有独立的起点，用于对比 LibRaw 的单线程解码器和并行解包。
+ */
+std::vector<uint8_t> makeSyntheticIiq(int width, int height) {
+    const double neutral[3] = {0.5, 1.0, 0.6};
+    const std::string model = "PixRaw Synthetic IIQ";
+
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> offsets(height);
+    std::vector<uint16_t> row(width);
+    uint32_t noise = 12345;
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            float rgb[3];
+            sceneColor(x, y, width, height, rgb);
+            int c = (y & 1) ? ((x & 1) ? 2 : 1) : ((x & 1) ? 1 : 0);
+            noise = noise * 1664525u + 1013904223u;
+            double value = 256 + rgb[c] * neutral[c] * (16383 - 256) * 0.9 + ((noise >> 24) & 0x0F);
+            row[x] = static_cast<uint16_t>(std::min(value, 16383.0));
+        }
+        offsets[y] = static_cast<uint32_t>(data.size());
+        encodePhaseOneRow(row.data(), width, data);
+    }
+
+    // 头部："IIII"、"Raw" 标记、目录偏移；目录项为 (tag, type, count, value/offset)
+    std::vector<uint8_t> out;
+    auto put32 = [&out](uint32_t x) {
+        for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>((x >> (i * 8)) & 0xFF));
+    };
+    auto putFloat = [&put32](float f) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        put32(bits);
+    };
+    const uint32_t entry_count = 11;
+    const uint32_t directory = 16;
+    const uint32_t cam_mul_offset = directory + 8 + entry_count * 16;
+    const uint32_t model_offset = cam_mul_offset + 12;
+    const uint32_t strip_offset = model_offset + 256;
+    const uint32_t data_offset = strip_offset + 4 * static_cast<uint32_t>(height);
+
+    put32(0x49494949);  // "IIII"：小端
+    put32(0x52617700);
+    put32(directory);
+    put32(0);
+    put32(entry_count);
+    put32(0);
+    const uint32_t entries[][4] = {
+        {0x107, 11, 3, cam_mul_offset},                        // 白平衡倍率
+        {0x108, 4, 1, static_cast<uint32_t>(width)},           // raw_width
+        {0x109, 4, 1, static_cast<uint32_t>(height)},          // raw_height
+        {0x10a, 4, 1, 0},                                      // left_margin
+        {0x10b, 4, 1, 0},                                      // top_margin
+        {0x10c, 4, 1, static_cast<uint32_t>(width)},           // width
+        {0x10d, 4, 1, static_cast<uint32_t>(height)},          // height
+        {0x10e, 4, 1, 3},                                      // 压缩格式
+        {0x10f, 4, 1, data_offset},                            // 数据偏移
+        {0x21c, 4, static_cast<uint32_t>(height), strip_offset},  // 行偏移表
+        {0x301, 1, static_cast<uint32_t>(model.size()), model_offset},
+    };
+    for (const auto& entry : entries) {
+        for (uint32_t value : entry) put32(value);
+    }
+    for (int c = 0; c < 3; ++c) putFloat(static_cast<float>(1.0 / neutral[c]));
+    out.insert(out.end(), model.begin(), model.end());
+    out.resize(strip_offset, 0);
+    for (uint32_t offset : offsets) put32(offset);
+    out.insert(out.end(), data.begin(), data.end());
+    return out;
+}
+
+RawImage makeSyntheticRgb(int width, int height) {
+    RawImage image(width, height, PixelFormat::RGB888);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = image.row(y);
+        for (int x = 0; x < width; ++x) {
+            float rgb[3];
+            sceneColor(x, y, width, height, rgb);
+            for (int c = 0; c < 3; ++c) row[x * 3 + c] = static_cast<uint8_t>(rgb[c] * 255.0f);
+        }
+    }
+    return image;
+}
+
+// === AoS 参考内核（交错 RGB888，逐阶段一次遍历），用于与 SoA 对比 ===
+
+inline uint8_t toUint8(float v) {
+    return static_cast<uint8_t>(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+}
+
+void aosExposure(RawImage& image, float exposure) {
+    float factor = std::pow(2.0f, exposure);
+    for (int y = 0; y < image.height(); ++y) {
+        uint8_t* row = image.row(y);
+        for (int i = 0; i < image.rowBytes(); ++i) row[i] = toUint8(row[i] * factor);
+    }
+}
+
+void aosContrast(RawImage& image, float contrast) {
+    float factor = (259.0f * (contrast + 255.0f)) / (255.0f * (259.0f - contrast));
+    for (int y = 0; y < image.height(); ++y) {
+        uint8_t* row = image.row(y);
+        for (int i = 0; i < image.rowBytes(); ++i) row[i] = toUint8(factor * (row[i] - 128.0f) + 128.0f);
+    }
+}
+
+void aosSaturation(RawImage& image, float saturation) {
+    float s = 1.0f + saturation / 100.0f;
+    for (int y = 0; y < image.height(); ++y) {
+        uint8_t* row = image.row(y);
+        for (int x = 0; x < image.width(); ++x) {
+            float r = row[x * 3], g = row[x * 3 + 1], b = row[x * 3 + 2];
+            float gray = 0.299f * r + 0.587f * g + 0.114f * b;
+            row[x * 3] = toUint8(gray + (r - gray) * s);
+            row[x * 3 + 1] = toUint8(gray + (g - gray) * s);
+            row[x * 3 + 2] = toUint8(gray + (b - gray) * s);
+        }
+    }
+}
+
+void aosTemperature(RawImage& image, float temperature) {
+    float f = temperature / 100.0f;
+    for (int y = 0; y < image.height(); ++y) {
+        uint8_t* row = image.row(y);
+        for (int x = 0; x < image.width(); ++x) {
+            float r = row[x * 3], b = row[x * 3 + 2];
+            if (temperature > 0) {
+                r = r + (255.0f - r) * f * 0.5f;
+                b = b * (1.0f - f * 0.3f);
+            } else {
+                r = r * (1.0f + f * 0.3f);
+                b = b + (255.0f - b) * (-f) * 0.5f;
+            }
+            row[x * 3] = toUint8(r);
+            row[x * 3 + 2] = toUint8(b);
+        }
+    }
+}
+
+// === 逐阶段参考实现（每个阶段单独遍历平面，运行时判断阶段），用于与融合内核对比 ===
+
+void stagedPass(PlanarImage& image, int first, int last, const std::function<void(float&)>& op) {
+    for (int c = first; c <= last; ++c) {
+        for (int y = 0; y < image.height(); ++y) {
+            float* row = image.row(c, y);
+            for (int x = 0; x < image.width(); ++x) op(row[x]);
+        }
+    }
+}
+
+inline float clamp01(float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); }
+
+RawImage stagedAdjust(const RawImage& image, const RawAdjustments& a) {
+    PlanarImage p = PlanarImage::fromInterleaved(image);
+    if (a.exposure != 0.0f) {
+        float f = std::pow(2.0f, a.exposure);
+        stagedPass(p, 0, 2, [f](float& v) { v = clamp01(v * f); });
+    }
+    if (a.contrast != 0.0f) {
+        float f = (259.0f * (a.contrast + 255.0f)) / (255.0f * (259.0f - a.contrast));
+        const float mid = 128.0f / 255.0f;
+        stagedPass(p, 0, 2, [f, mid](float& v) { v = clamp01(f * (v - mid) + mid); });
+    }
+    if (a.saturation != 0.0f) {
+        float s = 1.0f + a.saturation / 100.0f;
+        for (int y = 0; y < p.height(); ++y) {
+            float* r = p.row(0, y);
+            float* g = p.row(1, y);
+            float* b = p.row(2, y);
+            for (int x = 0; x < p.width(); ++x) {
+                float gray = 0.299f * r[x] + 0.587f * g[x] + 0.114f * b[x];
+                r[x] = clamp01(gray + (r[x] - gray) * s);
+                g[x] = clamp01(gray + (g[x] - gray) * s);
+                b[x] = clamp01(gray + (b[x] - gray) * s);
+            }
+        }
+    }
+    if (a.temperature != 0.0f) {
+        float f = a.temperature / 100.0f;
+        float rs = a.temperature > 0 ? 1.0f - f * 0.5f : 1.0f + f * 0.3f;
+        float ro = a.temperature > 0 ? f * 0.5f : 0.0f;
+        float bs = a.temperature > 0 ? 1.0f - f * 0.3f : 1.0f + f * 0.5f;
+        float bo = a.temperature > 0 ? 0.0f : -f * 0.5f;
+        stagedPass(p, 0, 0, [rs, ro](float& v) { v = clamp01(v * rs + ro); });
+        stagedPass(p, 2, 2, [bs, bo](float& v) { v = clamp01(v * bs + bo); });
+    }
+    if (a.tint != 0.0f) {
+        float f = std::pow(2.0f, -a.tint / 200.0f);
+        stagedPass(p, 1, 1, [f](float& v) { v = clamp01(v * f); });
+    }
+    return p.toInterleaved(image.format());
+}
+
+// 融合内核与逐阶段参考实现逐字节比较：5 个阶段的 32 种组合（色温取正负两种）x 3 种像素格式，
+// 返回不一致的组合数。ImageAdjuster.cpp 放宽了浮点语义，这里确认结果没有因此改变
+int verifyKernels(int width, int height) {
+    PlanarImage planar = PlanarImage::fromInterleaved(makeSyntheticRgb(width, height));
+    const std::pair<const char*, PixelFormat> formats[] = {
+        {"rgb888", PixelFormat::RGB888}, {"rgba8888", PixelFormat::RGBA8888}, {"rgb565", PixelFormat::RGB565}};
+
+    int mismatches = 0;
+    for (const auto& format : formats) {
+        RawImage input = planar.toInterleaved(format.second);
+        int checked = 0;
+        int identical = 0;
+        for (unsigned mask = 0; mask < 32; ++mask) {
+            for (float temperature : {25.0f, -25.0f}) {
+                if (!(mask & 8) && temperature < 0.0f) continue;
+                RawAdjustments a;
+                if (mask & 1) a.exposure = 0.5f;
+                if (mask & 2) a.contrast = 20.0f;
+                if (mask & 4) a.saturation = 30.0f;
+                if (mask & 8) a.temperature = temperature;
+                if (mask & 16) a.tint = 10.0f;
+
+                RawImage staged = stagedAdjust(input, a);
+                RawImage fused = ImageAdjuster::applyAdjustments(input, a);
+                bool same = staged.isValid() && fused.isValid() && staged.rowBytes() == fused.rowBytes();
+                for (int y = 0; same && y < staged.height(); ++y) {
+                    same = std::memcmp(staged.row(y), fused.row(y), static_cast<size_t>(staged.rowBytes())) == 0;
+                }
+                ++checked;
+                if (same) {
+                    ++identical;
+                } else {
+                    std::fprintf(stderr, "kernel/verify %s: mask %u (temperature %+g) differs from staged\n",
+                                 format.first, mask, temperature);
+                }
+            }
+        }
+        std::fprintf(stderr, "kernel/verify %-8s %d/%d combinations bit-identical\n", format.first, identical, checked);
+        mismatches += checked - identical;
+    }
+    return mismatches;
+}
+
+// === 基准组 ===
+
+bool isRawExtension(const fs::path& path) {
+    static const std::set<std::string> extensions = {
+        ".3fr", ".arw", ".cr2", ".cr3", ".crw", ".dng", ".erf", ".iiq", ".mos", ".nef", ".nrw",
+        ".orf", ".pef", ".raf", ".rw2", ".rwl", ".sr2", ".srf", ".srw", ".x3f"};
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensions.count(ext) > 0;
+}
+
+// 网页常用的一组输出版本
+std::vector<RenditionSpec> webRenditions() {
+    std::vector<RenditionSpec> specs(3);
+    specs[0].max_width = specs[0].max_height = 2048;
+    specs[1].max_width = specs[1].max_height = 1024;
+    specs[2].max_width = specs[2].max_height = 512;
+    return specs;
+}
+
+// 本次运行的临时目录：并发运行（如 CI 分片）各自写入合成文件，互不覆盖
+fs::path makeWorkDirectory() {
+    std::random_device random;
+    std::error_code ec;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "pixraw_bench_%08x", static_cast<unsigned>(random()));
+        fs::path dir = fs::temp_directory_path(ec) / name;
+        if (!ec && fs::create_directory(dir, ec)) {
+            return dir;
+        }
+    }
+    return fs::path();
+}
+
+// 文件相关：打开、元数据、缩略图、各解码档位；work_dir 存放写出的智能预览
+void benchFile(BenchRunner& runner, const std::string& path, const std::string& source, const fs::path& work_dir) {
+    PixRaw::PixRaw probe;
+    if (!probe.open(path)) {
+        std::fprintf(stderr, "skip %s: %s\n", path.c_str(), probe.getLastError().c_str());
+        return;
+    }
+    RawMetadata meta = probe.getMetadata();
+    double mp = static_cast<double>(meta.image_width) * meta.image_height / 1e6;
+    probe.close();
+
+    PixRaw::PixRaw raw;
+    runner.run("file/open", source, mp, [&] { raw.close(); }, [&] { raw.open(path); });
+    runner.run("file/metadata", source, mp, [&] { (void)raw.getMetadata(); });
+    runner.run("file/thumbnail_data", source, mp, [&] { raw.open(path); }, [&] { (void)raw.getThumbnailData(); });
+    runner.run("file/thumbnail", source, mp, [&] { raw.open(path); }, [&] { consume(raw.getThumbnail()); });
+    runner.run("file/signature", source, mp, [&] { raw.open(path); }, [&] { (void)raw.computeSignature(); });
+
+    // 解码结果会被缓存，每次迭代重新打开以测量完整解码
+    runner.run("decode/quick", source, mp, [&] { raw.open(path); }, [&] { consume(raw.decodeQuickPreview()); });
+    runner.run("decode/medium", source, mp, [&] { raw.open(path); }, [&] { consume(raw.decodeMediumPreview()); });
+    runner.run("decode/preview", source, mp, [&] { raw.open(path); }, [&] { consume(raw.decodePreview()); });
+    runner.run("decode/full", source, mp, [&] { raw.open(path); }, [&] { consume(raw.decodeFull()); });
+    const std::vector<RenditionSpec> web = webRenditions();
+    runner.run("decode/renditions", source, mp, [&] { raw.open(path); },
+               [&] { for (const RawImage& image : raw.decodeRenditions(web)) consume(image); });
+
+    // 已缓存解码后仅重新渲染（调整参数变化时的路径）
+    raw.open(path);
+    consume(raw.decodeFull());
+    RawAdjustments adjustments;
+    adjustments.exposure = 0.3f;
+    adjustments.contrast = 10.0f;
+    adjustments.temperature = 15.0f;
+    raw.setAdjustments(adjustments);
+    runner.run("decode/rerender_adjusted", source, mp, [&] { consume(raw.decodeFull()); });
+
+    // 曝光/白平衡滑块：每次迭代改变场景参考参数，只重建 LUT 并重新渲染
+    int step = 0;
+    runner.run("decode/rerender_scene", source, mp,
+               [&] {
+                   adjustments.exposure = 0.1f * (++step % 10);
+                   adjustments.wb_multipliers[0] = 2.0f + 0.05f * (step % 7);
+                   adjustments.wb_multipliers[1] = 1.0f;
+                   adjustments.wb_multipliers[2] = 1.5f;
+                   raw.setAdjustments(adjustments);
+               },
+               [&] { consume(raw.decodeFull()); });
+
+    // 智能预览：写出代理，再从代理打开并渲染（代替原始文件）
+    fs::path proxy = work_dir / "proxy.pxsp";
+    raw.open(path);
+    runner.run("proxy/write", source, mp, [&] { (void)raw.writeSmartPreview(proxy.string()); });
+    PixRaw::PixRaw preview;
+    runner.run("proxy/open_medium", source, mp, [&] {
+        preview.open(proxy.string());
+        consume(preview.decodeMediumPreview());
+    });
+    std::error_code ec;
+    fs::remove(proxy, ec);
+}
+
+// 两种解码器分别解包同一文件，逐字节比较 RAW 数据；无法解包或没有 CFA 数据时不比较
+bool verifyUnpack(const std::string& path, const std::string& source) {
+    std::unique_ptr<PixRaw::ParallelLibRaw> decoders[2] = {std::make_unique<PixRaw::ParallelLibRaw>(),
+                                                           std::make_unique<PixRaw::ParallelLibRaw>()};
+    for (int i = 0; i < 2; ++i) {
+        decoders[i]->setParallelUnpack(i == 1);
+        if (decoders[i]->open_file(path.c_str()) != LIBRAW_SUCCESS || decoders[i]->unpack() != LIBRAW_SUCCESS) {
+            return true;
+        }
+    }
+    const libraw_rawdata_t& serial = decoders[0]->imgdata.rawdata;
+    const libraw_rawdata_t& parallel = decoders[1]->imgdata.rawdata;
+    if (!serial.raw_image || !parallel.raw_image) {
+        return true;
+    }
+
+    const size_t bytes = static_cast<size_t>(serial.sizes.raw_pitch) * serial.sizes.raw_height;
+    const bool same = serial.sizes.raw_pitch == parallel.sizes.raw_pitch &&
+                      serial.sizes.raw_height == parallel.sizes.raw_height &&
+                      std::memcmp(serial.raw_image, parallel.raw_image, bytes) == 0;
+    std::fprintf(stderr, "unpack/verify %-24s raw data %s\n", source.c_str(), same ? "identical" : "differs");
+    return same;
+}
+
+// 解包：LibRaw 的单线程解码器 vs 并行解包（目前对压缩 IIQ 生效）
+// 通过 computeRawStatistics() 触发解包，两者都包含一次相同的 CFA 统计遍历；
+// 返回两者的 RAW 数据是否一致
+bool benchUnpack(BenchRunner& runner, const std::string& path, const std::string& source) {
+    PixRaw::PixRaw probe;
+    if (!probe.open(path)) {
+        std::fprintf(stderr, "skip %s: %s\n", path.c_str(), probe.getLastError().c_str());
+        return true;
+    }
+    RawMetadata meta = probe.getMetadata();
+    double mp = static_cast<double>(meta.raw_width) * meta.raw_height / 1e6;
+    probe.close();
+
+    for (bool parallel : {false, true}) {
+        PixRaw::PixRaw raw;
+        raw.setParallelUnpack(parallel);
+        runner.run(parallel ? "unpack/parallel" : "unpack/libraw", source, mp, [&] { raw.open(path); },
+                   [&] { (void)raw.computeRawStatistics(); });
+    }
+    return !runner.selected("unpack/verify") || verifyUnpack(path, source);
+}
+
+// 目录级导入：逐个 open(path) 与预取队列（不同深度）对比，每个文件打开并生成快速预览
+void benchIngest(BenchRunner& runner, const std::vector<std::string>& paths, const std::string& source) {
+    if (paths.empty()) {
+        return;
+    }
+
+    double mp = 0.0;
+    for (const std::string& path : paths) {
+        PixRaw::PixRaw probe;
+        if (probe.open(path)) {
+            RawMetadata meta = probe.getMetadata();
+            mp += static_cast<double>(meta.image_width) * meta.image_height / 1e6;
+        }
+    }
+
+    runner.run("ingest/serial", source, mp, [&] {
+        PixRaw::PixRaw raw;
+        for (const std::string& path : paths) {
+            if (raw.open(path)) consume(raw.decodeQuickPreview());
+        }
+    });
+
+    for (int depth : {1, 4, 8}) {
+        PrefetchOptions options;
+        options.depth = depth;
+        PrefetchStats stats;
+        runner.run("ingest/prefetch_d" + std::to_string(depth), source, mp, [&] {
+            PrefetchQueue queue(paths, options);
+            PixRaw::PixRaw raw;
+            PrefetchedFile file;
+            while (queue.next(file)) {
+                if (raw.open(std::move(file))) consume(raw.decodeQuickPreview());
+            }
+            stats = queue.stats();
+        });
+        if (stats.files > 0) {
+            std::fprintf(stderr, "  read %.1f ms, wait %.1f ms, compute %.1f ms, overlap %.0f%%, buffers %llu new / %llu reused\n",
+                         stats.read_ms, stats.wait_ms, stats.compute_ms, stats.overlap() * 100.0,
+                         static_cast<unsigned long long>(stats.buffers_allocated),
+                         static_cast<unsigned long long>(stats.buffers_reused));
+        }
+    }
+}
+
+// 像素阶段：各调整阶段（AoS/SoA）、色彩 LUT、resize、convertTo
+void benchStages(BenchRunner& runner, int width, int height) {
+    const std::string source = "synthetic";
+    const double mp = static_cast<double>(width) * height / 1e6;
+    RawImage rgb = makeSyntheticRgb(width, height);
+    PlanarImage planar = PlanarImage::fromInterleaved(rgb);
+
+    runner.run("layout/to_planar", source, mp, [&] { consume(PlanarImage::fromInterleaved(rgb)); });
+    runner.run("layout/to_interleaved", source, mp, [&] { consume(planar.toInterleaved(PixelFormat::RGB888)); });
+
+    struct Stage {
+        const char* name;
+        RawAdjustments adjustments;
+        std::function<void(RawImage&)> aos;
+    };
+    std::vector<Stage> stages(5);
+    stages[0].name = "exposure";
+    stages[0].adjustments.exposure = 0.5f;
+    stages[0].aos = [](RawImage& im) { aosExposure(im, 0.5f); };
+    stages[1].name = "contrast";
+    stages[1].adjustments.contrast = 20.0f;
+    stages[1].aos = [](RawImage& im) { aosContrast(im, 20.0f); };
+    stages[2].name = "saturation";
+    stages[2].adjustments.saturation = 30.0f;
+    stages[2].aos = [](RawImage& im) { aosSaturation(im, 30.0f); };
+    stages[3].name = "temperature";
+    stages[3].adjustments.temperature = 25.0f;
+    stages[3].aos = [](RawImage& im) { aosTemperature(im, 25.0f); };
+    stages[4].name = "all";
+    stages[4].adjustments.exposure = 0.5f;
+    stages[4].adjustments.contrast = 20.0f;
+    stages[4].adjustments.saturation = 30.0f;
+    stages[4].adjustments.temperature = 25.0f;
+    stages[4].aos = [](RawImage& im) {
+        aosExposure(im, 0.5f);
+        aosContrast(im, 20.0f);
+        aosSaturation(im, 30.0f);
+        aosTemperature(im, 25.0f);
+    };
+
+    for (const Stage& stage : stages) {
+        std::string base = std::string("adjust/") + stage.name;
+
+        RawImage aos_work;
+        runner.run(base + "/aos", source, mp, [&] { aos_work = rgb.clone(); }, [&] { stage.aos(aos_work); consume(aos_work); });
+
+        PlanarImage soa_work;
+        runner.run(base + "/soa", source, mp, [&] { soa_work = planar.clone(); },
+                   [&] { ImageAdjuster::applyAdjustments(soa_work, stage.adjustments); consume(soa_work); });
+
+        // RawImage 入口：包含 AoS <-> SoA 转换
+        runner.run(base + "/rawimage", source, mp,
+                   [&] { consume(ImageAdjuster::applyAdjustments(rgb, stage.adjustments)); });
+    }
+
+    // 融合内核矩阵：阶段组合 x 像素格式，逐阶段参考实现 vs 特化的融合内核
+    struct Combo {
+        const char* name;
+        RawAdjustments adjustments;
+    };
+    std::vector<Combo> combos(4);
+    combos[0].name = "e";
+    combos[0].adjustments.exposure = 0.5f;
+    combos[1].name = "ec";
+    combos[1].adjustments = combos[0].adjustments;
+    combos[1].adjustments.contrast = 20.0f;
+    combos[2].name = "ecs";
+    combos[2].adjustments = combos[1].adjustments;
+    combos[2].adjustments.saturation = 30.0f;
+    combos[3].name = "ecstn";
+    combos[3].adjustments = combos[2].adjustments;
+    combos[3].adjustments.temperature = 25.0f;
+    combos[3].adjustments.tint = 10.0f;
+
+    const std::pair<const char*, PixelFormat> formats[] = {
+        {"rgb888", PixelFormat::RGB888}, {"rgba8888", PixelFormat::RGBA8888}, {"rgb565", PixelFormat::RGB565}};
+    for (const auto& format : formats) {
+        RawImage input = planar.toInterleaved(format.second);  // convertTo 只支持 RGB888 -> RGBA8888
+        for (const Combo& combo : combos) {
+            std::string base = std::string("kernel/") + combo.name + "/" + format.first;
+            runner.run(base + "/staged", source, mp, [&] { consume(stagedAdjust(input, combo.adjustments)); });
+            runner.run(base + "/fused", source, mp,
+                       [&] { consume(ImageAdjuster::applyAdjustments(input, combo.adjustments)); });
+        }
+    }
+
+    ColorSettings color;
+    color.temperature = 20.0f;
+    runner.run("color/lut_build", source, 0.0, [&] { (void)ColorLut3D::build(CameraColor::identity(), color); });
+    std::shared_ptr<const ColorLut3D> lut = ColorLut3D::cached(CameraColor::identity(), color);
+    PlanarImage color_out(width, height);
+    runner.run("color/lut_apply", source, mp, [&] { lut->apply(planar, color_out); consume(color_out); });
+    HalfPlanarImage half = HalfPlanarImage::fromPlanar(planar);
+    runner.run("color/lut_apply_half", source, mp, [&] { lut->apply(half, color_out); consume(color_out); });
+
+    runner.run("signature/image", source, mp, [&] { (void)ImageSignature::fromImage(rgb); });
+
+    // 输出版本：融合的 Lanczos 缩小 + 锐化 + 打包 vs 分步（box 缩小 -> 交错 RGBA）
+    for (int edge : {2048, 1024, 512}) {
+        RenditionSpec spec;
+        spec.max_width = edge;
+        spec.max_height = edge;
+        std::string base = "rendition/" + std::to_string(edge);
+        runner.run(base + "/fused", source, mp, [&] { consume(RenditionRenderer::render(planar, spec)); });
+        int out_width = 0;
+        int out_height = 0;
+        RenditionRenderer::outputSize(width, height, spec, out_width, out_height);
+        runner.run(base + "/staged", source, mp, [&] {
+            PlanarImage resized(out_width, out_height);
+            planar.resampleInto(resized, 0, 0, width, height);
+            consume(resized.toInterleaved(PixelFormat::RGBA8888));
+        });
+    }
+    const std::vector<RenditionSpec> web = webRenditions();
+    runner.run("rendition/web_set", source, mp,
+               [&] { for (const RawImage& image : RenditionRenderer::render(planar, web)) consume(image); });
+
+    runner.run("image/resize_half", source, mp, [&] { consume(rgb.resize(width / 2, height / 2)); });
+    runner.run("image/resize_1024", source, mp, [&] { consume(rgb.resize(1024, 1024 * height / width)); });
+    runner.run("image/convert_rgba", source, mp, [&] { consume(rgb.convertTo(PixelFormat::RGBA8888)); });
+}
+
+void printUsage() {
+    std::fprintf(stderr,
+                 "usage: pixraw_bench [--corpus DIR] [--iterations N] [--width W] [--height H]\n"
+                 "                    [--filter SUBSTR] [--json FILE]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string corpus;
+    std::string json_path;
+    std::string filter;
+    int iterations = 5;
+    int width = 6000;
+    int height = 4000;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string { return i + 1 < argc ? argv[++i] : std::string(); };
+        if (arg == "--corpus") corpus = next();
+        else if (arg == "--json") json_path = next();
+        else if (arg == "--filter") filter = next();
+        else if (arg == "--iterations") iterations = std::atoi(next().c_str());
+        else if (arg == "--width") width = std::atoi(next().c_str());
+        else if (arg == "--height") height = std::atoi(next().c_str());
+        else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // Bayer 需要偶数尺寸
+    width = std::max(width & ~1, 64);
+    height = std::max(height & ~1, 64);
+
+    fs::path work_dir = makeWorkDirectory();
+    if (work_dir.empty()) {
+        std::fprintf(stderr, "failed to create a temporary directory\n");
+        return 1;
+    }
+
+    BenchRunner runner(iterations, filter);
+    int failures = 0; // 校验不一致的项数
+
+    // 合成 CFA：写入临时 DNG 后走与真实文件相同的路径
+    fs::path synthetic = work_dir / "synthetic.dng";
+    {
+        std::vector<uint8_t> dng = makeSyntheticDng(width, height);
+        std::ofstream out(synthetic, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(dng.data()), static_cast<std::streamsize>(dng.size()));
+    }
+    benchFile(runner, synthetic.string(), "synthetic", work_dir);
+
+    // 导入：同一合成文件的多个副本
+    std::vector<std::string> ingest_paths;
+    for (int i = 0; i < 8; ++i) {
+        fs::path copy = work_dir / ("ingest_" + std::to_string(i) + ".dng");
+        std::error_code copy_ec;
+        if (fs::copy_file(synthetic, copy, fs::copy_options::overwrite_existing, copy_ec)) {
+            ingest_paths.push_back(copy.string());
+        }
+    }
+    benchIngest(runner, ingest_paths, "synthetic");
+
+    // 合成压缩 IIQ：并行解包与 LibRaw 单线程解码器对比
+    fs::path synthetic_iiq = work_dir / "synthetic.iiq";
+    {
+        std::vector<uint8_t> iiq = makeSyntheticIiq(width, height);
+        std::ofstream out(synthetic_iiq, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(iiq.data()), static_cast<std::streamsize>(iiq.size()));
+    }
+    if (!benchUnpack(runner, synthetic_iiq.string(), "synthetic_iiq")) ++failures;
+
+    std::error_code ec;
+    for (const std::string& path : ingest_paths) fs::remove(path, ec);
+    fs::remove(synthetic, ec);
+    fs::remove(synthetic_iiq, ec);
+
+    benchStages(runner, width, height);
+    // 奇数尺寸覆盖向量化循环的尾部
+    if (runner.selected("kernel/verify")) failures += verifyKernels(257, 131);
+
+    if (!corpus.empty()) {
+        std::vector<fs::path> files;
+        for (const auto& entry : fs::recursive_directory_iterator(corpus, ec)) {
+            if (entry.is_regular_file() && isRawExtension(entry.path())) files.push_back(entry.path());
+        }
+        std::sort(files.begin(), files.end());
+        for (const fs::path& file : files) {
+            benchFile(runner, file.string(), file.filename().string(), work_dir);
+            if (!benchUnpack(runner, file.string(), file.filename().string())) ++failures;
+        }
+
+        std::vector<std::string> corpus_paths;
+        for (const fs::path& file : files) corpus_paths.push_back(file.string());
+        benchIngest(runner, corpus_paths, "corpus");
+    }
+    fs::remove_all(work_dir, ec);
+
+    if (json_path.empty()) {
+        runner.writeJson(std::cout, width, height);
+    } else {
+        std::ofstream out(json_path);
+        runner.writeJson(out, width, height);
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#ifndef RAW_PROCESSOR_CANCELLATION_H
+#define RAW_PROCESSOR_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace PixRaw {
+
+/**
+ * @brief 解码调用的结果状态
+ */
+enum class DecodeStatus {
+    Success,
+    Failed,             // 普通错误，详见 getLastError()
+    Cancelled,          // 被 CancellationToken::cancel() 取消
+    DeadlineExceeded    // 超过截止时间
+};
+
+/**
+ * @brief 协作式取消令牌
+ *
+ * 拷贝共享同一状态，可在任意线程调用 cancel()。默认构造的令牌永不取消，
+ * 不产生任何开销；需要取消时使用 create() / withDeadline() / withTimeout()。
+ */
+class CancellationToken {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken() = default;
+
+    static CancellationToken create();
+    static CancellationToken withDeadline(Clock::time_point deadline);
+    static CancellationToken withTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief 请求取消（幂等，空令牌上为空操作）
+     */
+    void cancel() const;
+
+    /**
+     * @brief 是否已取消或已超过截止时间
+     */
+    bool isCancelled() const;
+
+    /**
+     * @brief Success（未取消）、Cancelled 或 DeadlineExceeded
+     */
+    DecodeStatus status() const;
+
+    bool canBeCancelled() const { return state_ != nullptr; }
+
+    /**
+     * @brief 注册取消监听（cancel() 时在调用线程上执行；已取消时立即执行）
+     * @return 监听 ID，空令牌返回 -1
+     *
+     * 截止时间不会触发监听，只能通过 isCancelled() 轮询。
+     */
+    int addListener(std::function<void()> listener) const;
+
+    /**
+     * @brief 移除监听；返回后该监听不会再被执行
+     */
+    void removeListener(int id) const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state_;
+};
+
+/**
+ * @brief 行带粒度的取消检查
+ *
+ * 在（可能并行的）逐行循环中使用：每 kRowBand 行查询一次令牌，
+ * 一旦取消，其余行直接跳过。
+ */
+class RowBandCancellation {
+public:
+    static constexpr int kRowBand = 64;
+
+    explicit RowBandCancellation(const CancellationToken& token) : token_(token) {}
+
+    // 返回 true 表示应跳过第 y 行
+    bool skip(int y) {
+        if (!token_.canBeCancelled()) {
+            return false;
+        }
+        if (stopped_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        if (y % kRowBand == 0 && token_.isCancelled()) {
+            stopped_.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool stopped() const { return stopped_.load(std::memory_order_relaxed); }
+
+private:
+    const CancellationToken& token_;
+    std::atomic<bool> stopped_{false};
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_CANCELLATION_H
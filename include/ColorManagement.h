@@ -0,0 +1,115 @@
+#ifndef RAW_PROCESSOR_COLOR_MANAGEMENT_H
+#define RAW_PROCESSOR_COLOR_MANAGEMENT_H
+
+#include <Cancellation.h>
+#include <HalfPlanarImage.h>
+#include <PlanarImage.h>
+#include <RawAdjustments.h>
+#include <memory>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 输出色彩空间
+ */
+enum class OutputColorSpace {
+    sRGB,       // sRGB 原色 + sRGB 传递函数
+    DisplayP3,  // P3 原色（D65）+ sRGB 传递函数
+    AdobeRGB,   // Adobe RGB (1998)，gamma 2.2
+    Rec2020,    // BT.2020 原色 + BT.2020 传递函数
+    Linear      // sRGB 原色，线性
+};
+
+/**
+ * @brief 相机色彩数据
+ *
+ * rgb_cam 把白平衡后的相机 RGB 映射到线性 sRGB（来自 LibRaw 的 color.rgb_cam）。
+ * cam_mul 为解码时实际使用的白平衡倍率（LibRaw 的 pre_mul，按绿色归一化）。
+ */
+struct CameraColor {
+    float rgb_cam[3][3] = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+    float cam_mul[3] = {1.0f, 1.0f, 1.0f};
+
+    // 单位矩阵：输入已经是线性 sRGB
+    static CameraColor identity() { return CameraColor(); }
+};
+
+/**
+ * @brief 色彩管理参数
+ *
+ * exposure 与 white_balance 是场景参考（线性）参数，语义同 LibRaw 的
+ * exp_shift 和 user_mul，但作用于缓存的线性图像，修改时无需重新 dcraw_process()。
+ */
+struct ColorSettings {
+    OutputColorSpace output_space = OutputColorSpace::sRGB;
+    float exposure = 0.0f;      // 线性曝光增益 (EV)
+    float white_balance[3] = {0.0f, 0.0f, 0.0f};  // 相机 RGB 白平衡倍率，全 0 表示拍摄时白平衡
+    float temperature = 0.0f;   // 色温 (-100 ~ 100, 负数=冷, 正数=暖)
+    float tint = 0.0f;          // 色调 (-100 ~ 100, 负数=偏绿, 正数=偏品红)
+    int lut_size = 33;          // 3D LUT 每维节点数
+
+    /**
+     * @brief 从调整参数中取出场景参考部分（曝光、白平衡、色温/色调）
+     *
+     * 其余参数用 RawAdjustments::displayReferred() 在显示空间处理。
+     */
+    static ColorSettings sceneReferred(const RawAdjustments& adjustments,
+                                       OutputColorSpace output_space = OutputColorSpace::sRGB);
+};
+
+/**
+ * @brief 相机 RGB -> 输出编码的 3D LUT
+ *
+ * 将相机空间的曝光/白平衡/色温/色调倍率、相机矩阵、输出原色转换、
+ * 裁剪和传递函数合并为一张 LUT。输入先经过 sqrt 整形以提高暗部精度，
+ * 再做四面体插值，单次遍历完成整个色彩变换。
+ */
+class ColorLut3D {
+public:
+    /**
+     * @brief 构建 LUT
+     */
+    static ColorLut3D build(const CameraColor& camera, const ColorSettings& settings);
+
+    /**
+     * @brief 获取缓存的 LUT（按相机矩阵和参数缓存，进程内共享，线程安全）
+     */
+    static std::shared_ptr<const ColorLut3D> cached(const CameraColor& camera, const ColorSettings& settings);
+
+    /**
+     * @brief 清空 LUT 缓存
+     */
+    static void clearCache();
+
+    /**
+     * @brief 应用 LUT：src 为线性相机 RGB，dst 为输出编码值（尺寸需与 src 相同）
+     * @param token 按行带检查取消，取消后 dst 内容不完整
+     */
+    void apply(const PlanarImage& src, PlanarImage& dst,
+               const CancellationToken& token = CancellationToken()) const;
+
+    /**
+     * @brief 应用 LUT：src 为半精度线性缓存，逐行解码后插值
+     */
+    void apply(const HalfPlanarImage& src, PlanarImage& dst,
+               const CancellationToken& token = CancellationToken()) const;
+
+    // 原地应用
+    void apply(PlanarImage& image) const { apply(image, image); }
+
+    int size() const { return size_; }
+    bool isValid() const { return size_ > 1; }
+
+private:
+    // 对一行做四面体插值
+    void applyRow(const float* in_r, const float* in_g, const float* in_b,
+                  float* out_r, float* out_g, float* out_b, int width) const;
+
+    int size_ = 0;
+    std::vector<float> table_;  // size^3 个节点，每个节点 RGB 交错，按 r 最慢、b 最快排列
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_COLOR_MANAGEMENT_H
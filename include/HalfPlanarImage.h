@@ -0,0 +1,92 @@
+#ifndef RAW_PROCESSOR_HALF_PLANAR_IMAGE_H
+#define RAW_PROCESSOR_HALF_PLANAR_IMAGE_H
+
+#include <PlanarImage.h>
+#include <cstdint>
+#include <memory>
+
+namespace PixRaw {
+
+/**
+ * @brief 半精度浮点（IEEE binary16）平面 RGB 图像
+ *
+ * 用于缓存去马赛克后的场景线性数据：内存为 PlanarImage 的一半，
+ * 精度（11 位有效位）对线性数据足够。处理时逐行解码为 float。
+ * 每个平面的行按 64 字节对齐。
+ */
+class HalfPlanarImage {
+public:
+    static constexpr int kChannels = 3;
+
+    HalfPlanarImage();
+    HalfPlanarImage(int width, int height);
+    ~HalfPlanarImage();
+
+    // 禁止拷贝
+    HalfPlanarImage(const HalfPlanarImage&) = delete;
+    HalfPlanarImage& operator=(const HalfPlanarImage&) = delete;
+
+    // 移动
+    HalfPlanarImage(HalfPlanarImage&&) noexcept;
+    HalfPlanarImage& operator=(HalfPlanarImage&&) noexcept;
+
+    /**
+     * @brief 从紧密排列的 RGB 数据转换（LibRaw 输出，8 或 16 位）
+     */
+    static HalfPlanarImage fromPacked(const void* data, int width, int height, int bits);
+
+    /**
+     * @brief 从 float 平面图像转换
+     */
+    static HalfPlanarImage fromPlanar(const PlanarImage& image);
+
+    /**
+     * @brief 转换为 float 平面图像
+     */
+    PlanarImage toPlanar() const;
+
+    /**
+     * @brief 把区域 (x, y, width, height) 缩放到 dst 的尺寸（与 PlanarImage::resampleInto 结果相同）
+     *
+     * 源行逐行解码为 float 后累加，不展开整幅图像。
+     */
+    void resampleInto(PlanarImage& dst, int x, int y, int width, int height,
+                      const CancellationToken& token = CancellationToken()) const;
+
+    // 平面访问（channel: 0=R, 1=G, 2=B）
+    uint16_t* plane(int channel) { return data_ + static_cast<size_t>(channel) * planeSize(); }
+    const uint16_t* plane(int channel) const { return data_ + static_cast<size_t>(channel) * planeSize(); }
+
+    uint16_t* row(int channel, int y) { return plane(channel) + static_cast<size_t>(y) * stride_; }
+    const uint16_t* row(int channel, int y) const { return plane(channel) + static_cast<size_t>(y) * stride_; }
+
+    // 将一行解码为 float
+    void loadRow(int channel, int y, float* dst) const { toFloat(row(channel, y), dst, width_); }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int stride() const { return stride_; }  // 以元素为单位
+
+    size_t byteSize() const { return planeSize() * kChannels * sizeof(uint16_t); }
+
+    bool isValid() const { return data_ != nullptr; }
+
+    // 单值与批量转换（有 F16C 时使用硬件指令）
+    static uint16_t toHalf(float value);
+    static float toFloat(uint16_t value);
+    static void toHalf(const float* src, uint16_t* dst, int count);
+    static void toFloat(const uint16_t* src, float* dst, int count);
+
+private:
+    size_t planeSize() const { return static_cast<size_t>(stride_) * height_; }
+
+    int width_ = 0;
+    int height_ = 0;
+    int stride_ = 0;
+    std::shared_ptr<uint16_t> buffer_;
+    uint16_t* data_ = nullptr;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_HALF_PLANAR_IMAGE_H
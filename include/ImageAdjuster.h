@@ -1,7 +1,9 @@
 #ifndef RAW_PROCESSOR_IMAGE_ADJUSTER_H
 #define RAW_PROCESSOR_IMAGE_ADJUSTER_H
 
+#include <Cancellation.h>
 #include <RawImage.h>
+#include <PlanarImage.h>
 #include <RawAdjustments.h>
 
 namespace PixRaw {
@@ -9,28 +11,28 @@ namespace PixRaw {
 /**
  * @brief 图像后处理器
  *
- * 在 RAW 解码后应用各种图像调整
+ * 在 RAW 解码后应用各种图像调整。启用的阶段组合（曝光、对比度、饱和度、
+ * 色温、色调）和像素格式都是内核的模板参数：每种组合实例化一个融合内核，
+ * 通过分派表选择，每个像素一次遍历完成所有阶段，内循环没有分支和间接调用。
  */
 class ImageAdjuster {
 public:
     /**
      * @brief 应用调整参数到图像
+     *
+     * 直接在交错像素上处理（按格式特化），不经过平面图像；RGBA8888 保留 alpha。
      * @param image 原始图像
      * @param adjustments 调整参数
-     * @return 处理后的图像
+     * @return 处理后的图像（与输入格式相同）
      */
     static RawImage applyAdjustments(const RawImage& image, const RawAdjustments& adjustments);
 
-private:
-    // 各种调整的底层实现
-    static void applyExposure(uint8_t* data, int width, int height, float exposure);
-    static void applyContrast(uint8_t* data, int width, int height, float contrast);
-    static void applySaturation(uint8_t* data, int width, int height, float saturation);
-    static void applyTemperature(uint8_t* data, int width, int height, float temperature);
-
-    // 辅助函数
-    static float clamp(float value, float min, float max);
-    static uint8_t toUint8(float value);
+    /**
+     * @brief 原地应用调整参数到平面图像
+     * @param token 按行带检查取消，取消后图像内容不完整
+     */
+    static void applyAdjustments(PlanarImage& image, const RawAdjustments& adjustments,
+                                 const CancellationToken& token = CancellationToken());
 };
 
 } // namespace PixRaw
@@ -0,0 +1,82 @@
+#ifndef RAW_PROCESSOR_IMAGE_SIGNATURE_H
+#define RAW_PROCESSOR_IMAGE_SIGNATURE_H
+
+#include <Cancellation.h>
+#include <RawImage.h>
+#include <cstdint>
+#include <functional>
+
+namespace PixRaw {
+
+/**
+ * @brief 签名的数据来源
+ */
+enum class SignatureSource : int {
+    None = 0,
+    Thumbnail,      // 嵌入的位图缩略图
+    RawCfa,         // 2x2 合并的 CFA 数据（只解包，不去马赛克）
+    SmartPreview,   // 智能预览的线性图像
+    Image           // 调用者提供的图像
+};
+
+/**
+ * @brief 连拍筛选用的图像签名：感知哈希、颜色签名和锐度
+ *
+ * 同一连拍中的近似重复帧感知哈希的汉明距离很小（通常 <= 10），颜色签名接近；
+ * 锐度用于在一组中挑出对焦最准的一张。锐度与分析分辨率有关，只在同一相机、
+ * 同一来源的签名之间可比。
+ */
+struct ImageSignature {
+    static constexpr int kColorGrid = 4;   // 颜色签名为 4x4 网格
+    static constexpr int kColorBytes = kColorGrid * kColorGrid * 3;
+
+    uint64_t perceptual_hash = 0;          // 64 位 DCT 感知哈希（32x32 亮度的 8x8 低频与中值比较）
+    uint8_t color[kColorBytes] = {};       // 各网格的平均颜色（RGB，感知编码，行优先）
+    float sharpness = 0.0f;                // 亮度（0~255）拉普拉斯响应的方差
+    float sharpness_peak = 0.0f;           // 4x4 网格中最大的拉普拉斯方差（主体清晰、背景虚化时更可靠）
+    int analysis_width = 0;                // 分析所用图像的尺寸
+    int analysis_height = 0;
+    SignatureSource source = SignatureSource::None;
+
+    bool isValid() const { return source != SignatureSource::None; }
+
+    /**
+     * @brief 感知哈希的汉明距离（0~64）
+     */
+    static int hashDistance(uint64_t a, uint64_t b);
+
+    int hashDistance(const ImageSignature& other) const { return hashDistance(perceptual_hash, other.perceptual_hash); }
+
+    /**
+     * @brief 颜色签名的均方根差，归一化到 [0, 1]
+     */
+    float colorDistance(const ImageSignature& other) const;
+
+    /**
+     * @brief 逐行提供 RGB 数据的回调
+     *
+     * 将第 y 行写入 r/g/b（各 width 个 float）。会被多个线程同时调用，必须只读共享数据。
+     */
+    using RowSource = std::function<void(int y, float* r, float* g, float* b)>;
+
+    /**
+     * @brief 从逐行数据计算签名
+     *
+     * 按行带并行的单次遍历：每行计算亮度后同时累加 32x32 哈希网格、4x4 颜色网格，
+     * 并用相邻行的滚动窗口计算拉普拉斯响应，不生成中间图像。
+     * @param linear true 表示输入为场景线性值（先做平方根编码再分析），false 表示已是显示编码值
+     * @param source 记录到结果中的来源
+     * @return 尺寸小于 32x32 或取消时返回无效签名
+     */
+    static ImageSignature compute(int width, int height, const RowSource& rows, bool linear,
+                                  SignatureSource source, const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief 从已解码的图像计算签名（显示编码值）
+     */
+    static ImageSignature fromImage(const RawImage& image, const CancellationToken& token = CancellationToken());
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_IMAGE_SIGNATURE_H
@@ -0,0 +1,125 @@
+#ifndef RAW_PROCESSOR_IMAGE_STATISTICS_H
+#define RAW_PROCESSOR_IMAGE_STATISTICS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 统计参数
+ */
+struct StatisticsOptions {
+    bool enabled = false;
+    int bins = 256;                     // 每通道直方图桶数：256（8 位）或 65536（16 位）
+    bool clip_mask = false;             // 是否生成逐像素裁剪遮罩
+    float highlight_threshold = 1.0f;   // >= 该值视为高光溢出（[0, 1]）
+    float shadow_threshold = 0.0f;      // <= 该值视为阴影裁剪（[0, 1]）
+};
+
+/**
+ * @brief 直方图、裁剪和亮度统计
+ *
+ * 通道索引：0=R, 1=G, 2=B, 3=亮度（Rec.709 权重，按输出编码值计算）。
+ * 对 RAW CFA 统计，每个通道只统计对应颜色的采样，不含亮度；单色传感器的采样计入亮度通道。
+ */
+struct ImageStatistics {
+    static constexpr int kRed = 0;
+    static constexpr int kGreen = 1;
+    static constexpr int kBlue = 2;
+    static constexpr int kLuma = 3;
+    static constexpr int kChannels = 4;
+
+    // 裁剪遮罩位
+    static constexpr uint8_t kClipRed = 1 << 0;
+    static constexpr uint8_t kClipGreen = 1 << 1;
+    static constexpr uint8_t kClipBlue = 1 << 2;
+    static constexpr uint8_t kClipShadow = 1 << 3;  // 所有通道均处于阴影裁剪
+
+    int bins = 0;
+    uint64_t pixel_count = 0;
+    uint64_t count[kChannels] = {};                 // 每通道样本数
+    std::vector<uint64_t> histogram[kChannels];
+    uint64_t highlight_clipped[kChannels] = {};
+    uint64_t shadow_clipped[kChannels] = {};
+    double mean[kChannels] = {};                    // [0, 1]
+
+    // 裁剪遮罩（可选），每像素一字节，行优先、无填充
+    std::vector<uint8_t> clip_mask;
+    int mask_width = 0;
+    int mask_height = 0;
+
+    /**
+     * @brief 百分位数（p ∈ [0, 1]），返回 [0, 1] 中的值
+     */
+    float percentile(int channel, double p) const;
+
+    bool isValid() const { return pixel_count > 0; }
+};
+
+/**
+ * @brief 统计累加器
+ *
+ * 每个线程持有一个累加器，在最终写出循环中逐像素累加，结束后合并。
+ */
+class StatisticsAccumulator {
+public:
+    explicit StatisticsAccumulator(const StatisticsOptions& options);
+
+    int bins() const { return bins_; }
+
+    // [0, 1] 浮点值 -> 桶索引
+    int bin(float value) const {
+        float v = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return static_cast<int>(v * scale_ + 0.5f);
+    }
+
+    // 累加单个通道样本
+    void addSample(int channel, int b) {
+        ++histogram_[channel][b];
+        ++count_[channel];
+        sum_[channel] += static_cast<uint64_t>(b);
+        if (b >= highlight_bin_) ++highlight_[channel];
+        if (b <= shadow_bin_) ++shadow_[channel];
+    }
+
+    // 累加一个 RGB 像素及其亮度，返回裁剪遮罩位
+    uint8_t addPixel(int r, int g, int b, int luma) {
+        addSample(0, r);
+        addSample(1, g);
+        addSample(2, b);
+        addSample(3, luma);
+        ++pixels_;
+        uint8_t mask = 0;
+        if (r >= highlight_bin_) mask |= ImageStatistics::kClipRed;
+        if (g >= highlight_bin_) mask |= ImageStatistics::kClipGreen;
+        if (b >= highlight_bin_) mask |= ImageStatistics::kClipBlue;
+        if (r <= shadow_bin_ && g <= shadow_bin_ && b <= shadow_bin_) mask |= ImageStatistics::kClipShadow;
+        return mask;
+    }
+
+    void addPixels(uint64_t n) { pixels_ += n; }
+
+    void merge(const StatisticsAccumulator& other);
+
+    /**
+     * @brief 写出结果（保留 out 中已有的裁剪遮罩）
+     */
+    void finish(ImageStatistics& out) const;
+
+private:
+    int bins_;
+    float scale_;
+    int highlight_bin_;
+    int shadow_bin_;
+    uint64_t pixels_ = 0;
+    std::vector<uint64_t> histogram_[ImageStatistics::kChannels];
+    uint64_t count_[ImageStatistics::kChannels] = {};
+    uint64_t sum_[ImageStatistics::kChannels] = {};
+    uint64_t highlight_[ImageStatistics::kChannels] = {};
+    uint64_t shadow_[ImageStatistics::kChannels] = {};
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_IMAGE_STATISTICS_H
@@ -0,0 +1,196 @@
+#ifndef RAW_PROCESSOR_INSTRUMENTATION_H
+#define RAW_PROCESSOR_INSTRUMENTATION_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 解码流程中的阶段
+ */
+enum class DecodeStage : int {
+    Open,       // open_file：解析文件头
+    Unpack,     // unpack()：读取并解压 RAW 数据
+    Process,    // dcraw_process()：去马赛克等
+    MakeImage,  // dcraw_make_mem_image()
+    Convert,    // LibRaw 输出 -> 内部平面图像
+    Color,      // 色彩 LUT
+    Adjust,     // ImageAdjuster
+    Output,     // 平面 -> 交错输出（含拷贝）
+    Thumbnail,  // 缩略图解包/生成
+    Signature,  // 感知哈希/颜色签名/锐度
+    Count
+};
+
+constexpr int kStageCount = static_cast<int>(DecodeStage::Count);
+
+/**
+ * @brief 阶段名称（用于直方图与 trace）
+ */
+const char* stageName(DecodeStage stage);
+
+struct StageTiming {
+    double wall_ms = 0.0;
+    double cpu_ms = 0.0;   // 进程 CPU 时间（包含 OpenMP 工作线程）
+    int calls = 0;
+};
+
+/**
+ * @brief 单次调用的统计结果
+ *
+ * bytes_allocated 为流程中已知大缓冲区（LibRaw 原始/工作图像、
+ * 输出图像、缓存和返回图像）的估算总和，不包含小对象分配。
+ * peak_rss_bytes 在调用开始、每个阶段结束和调用结束时采样常驻内存，取最大值；
+ * 阶段内部的瞬时峰值（例如 dcraw_process() 的临时缓冲区）不一定能采到。
+ */
+struct DecodeStats {
+    std::string operation;          // 例如 "decodePreview"
+    StageTiming stages[kStageCount];
+    double wall_ms = 0.0;
+    double cpu_ms = 0.0;
+    uint64_t bytes_read = 0;        // 从文件读取的字节数（从内存打开时为缓冲区大小，计入打开调用）
+    uint64_t bytes_allocated = 0;   // 估算的分配字节数
+    uint64_t peak_rss_bytes = 0;    // 本次调用期间采样到的常驻内存峰值
+    uint64_t process_peak_rss_bytes = 0; // 调用结束时整个进程生命周期内的常驻内存峰值
+    int64_t rss_delta_bytes = 0;    // 调用前后常驻内存变化
+
+    const StageTiming& stage(DecodeStage s) const { return stages[static_cast<int>(s)]; }
+    StageTiming& stage(DecodeStage s) { return stages[static_cast<int>(s)]; }
+
+    bool isValid() const { return !operation.empty(); }
+};
+
+/**
+ * @brief trace 区间（Chrome trace 的 "X" 事件）
+ */
+struct TraceSpan {
+    std::string name;
+    std::string category;
+    double start_us = 0.0;      // 相对进程内固定起点
+    double duration_us = 0.0;
+    uint64_t thread_id = 0;
+};
+
+/**
+ * @brief 进程级直方图快照（单位 ms）
+ *
+ * 百分位数取自对数分桶的桶上界，相对误差不超过一个桶宽（约 19%）。
+ */
+struct HistogramSnapshot {
+    std::string operation;
+    std::string stage;          // 阶段名，"total" 表示整个调用
+    uint64_t count = 0;
+    double sum_ms = 0.0;
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+    double p50_ms = 0.0;
+    double p90_ms = 0.0;
+    double p99_ms = 0.0;
+};
+
+/**
+ * @brief 进程级插桩注册表（线程安全）
+ */
+class Instrumentation {
+public:
+    /**
+     * @brief 将一次调用的统计并入进程级直方图
+     */
+    static void record(const DecodeStats& stats);
+
+    /**
+     * @brief 获取所有 (操作, 阶段) 直方图
+     */
+    static std::vector<HistogramSnapshot> histograms();
+
+    static void resetHistograms();
+
+    /**
+     * @brief 开始记录 Chrome trace，stopChromeTrace() 时写入 path
+     */
+    static bool startChromeTrace(const std::string& path);
+
+    /**
+     * @brief 停止记录并写出 trace JSON（chrome://tracing / Perfetto 可直接打开）
+     */
+    static bool stopChromeTrace();
+
+    /**
+     * @brief 设置 trace 区间回调，用于导出到其他系统（传空函数取消）
+     */
+    static void setSpanCallback(std::function<void(const TraceSpan&)> callback);
+
+    // 是否有 trace 消费者（Chrome trace 或回调）
+    static bool tracing();
+
+    static void emitSpan(const TraceSpan& span);
+
+    // 平台工具
+    static double nowMicros();
+    static double processCpuMillis();
+    static uint64_t currentRssBytes();
+    static uint64_t peakRssBytes();     // 进程生命周期内的峰值，不能区分单次调用
+    static uint64_t currentThreadId();
+};
+
+/**
+ * @brief 调用级统计记录器
+ *
+ * begin()/end() 可嵌套，只有最外层调用生成一份 DecodeStats。
+ * 未启用时所有操作都是空操作。
+ */
+class StatsRecorder {
+public:
+    class Scope {
+    public:
+        Scope(StatsRecorder* recorder, DecodeStage stage);
+        ~Scope();
+        Scope(Scope&& other) noexcept;
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+
+    private:
+        StatsRecorder* recorder_;
+        DecodeStage stage_;
+        double start_us_ = 0.0;
+        double start_cpu_ms_ = 0.0;
+    };
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool isEnabled() const { return enabled_; }
+
+    void begin(const char* operation, uint64_t bytes_read_so_far = 0);
+    void end(uint64_t bytes_read_so_far = 0);
+
+    // 计时一个阶段（RAII）
+    Scope stage(DecodeStage stage) { return Scope(active() ? this : nullptr, stage); }
+
+    void addAllocated(uint64_t bytes) {
+        if (active()) current_.bytes_allocated += bytes;
+    }
+
+    const DecodeStats& last() const { return last_; }
+
+private:
+    bool active() const { return enabled_ && depth_ > 0; }
+
+    // 采样常驻内存，更新本次调用的峰值
+    void sampleRss();
+
+    bool enabled_ = false;
+    int depth_ = 0;
+    DecodeStats current_;
+    DecodeStats last_;
+    double start_us_ = 0.0;
+    double start_cpu_ms_ = 0.0;
+    uint64_t start_bytes_read_ = 0;
+    uint64_t start_rss_ = 0;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_INSTRUMENTATION_H
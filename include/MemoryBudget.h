@@ -0,0 +1,147 @@
+#ifndef RAW_PROCESSOR_MEMORY_BUDGET_H
+#define RAW_PROCESSOR_MEMORY_BUDGET_H
+
+#include <Cancellation.h>
+#include <RawMetadata.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 进程级内存预算
+ */
+struct MemoryBudgetOptions {
+    uint64_t budget_bytes = 0;      // 所有实例预留之和的上限，0 表示不限制（仍统计预留）
+    bool allow_downgrade = true;    // 预算不足时把全尺寸解码降为 half_size，而不是排队等待
+};
+
+/**
+ * @brief 一次解码的内存估算（单位字节，按 Bayer 传感器估算）
+ *
+ * raw/cache 在调用结束后由实例保留（关闭或重新打开时释放），
+ * processed/transient 只在调用期间存在。
+ */
+struct MemoryEstimate {
+    uint64_t raw_bytes = 0;         // unpack() 的 RAW 数据（每像素 2 字节）
+    uint64_t processed_bytes = 0;   // dcraw_process() 的工作图像（每像素 8 字节，拷贝出输出后释放）
+    uint64_t cache_bytes = 0;       // 线性图像缓存（半精度平面，每像素 6 字节）
+    uint64_t transient_bytes = 0;   // LibRaw 输出拷贝、渲染工作图像与输出图像中的较大者
+
+    uint64_t retained() const { return raw_bytes + cache_bytes; }
+    uint64_t peak() const { return retained() + processed_bytes + transient_bytes; }
+};
+
+/**
+ * @brief 一项预留（监控用快照）
+ */
+struct MemoryReservationInfo {
+    uint64_t id = 0;
+    std::string operation;          // 最近一次申请的操作，例如 "decodePreview"
+    uint64_t bytes = 0;
+    bool in_flight = false;         // 调用进行中；否则为实例缓存保留的内存
+    bool downgraded = false;        // 最近一次申请是否降级
+    double age_ms = 0.0;            // 自创建起经过的时间
+};
+
+/**
+ * @brief 内存预算快照
+ */
+struct MemoryBudgetStats {
+    uint64_t budget_bytes = 0;
+    uint64_t reserved_bytes = 0;        // 当前预留总和
+    uint64_t peak_reserved_bytes = 0;   // 预留总和的历史峰值
+    int in_flight = 0;                  // 进行中的调用数
+    int queued = 0;                     // 正在排队的申请数
+
+    // 累计计数
+    uint64_t admitted = 0;              // 直接准入
+    uint64_t admitted_after_wait = 0;   // 排队后准入
+    uint64_t downgraded = 0;            // 降级为 half_size 后准入
+    uint64_t overcommitted = 0;         // 超出预算准入（没有其他进行中的调用可等待）
+    uint64_t cancelled = 0;             // 排队期间被取消或超时
+    double wait_ms = 0.0;               // 累计排队时间
+
+    std::vector<MemoryReservationInfo> reservations;
+};
+
+/**
+ * @brief 一个实例在进程级预算中的预留（RAII，析构时释放）
+ *
+ * 预留在调用开始时按估算的峰值申请，调用结束时 settle() 为实例实际保留的缓存大小，
+ * 因此排队的申请既会等进行中的调用结束，也会等其他实例关闭。
+ */
+class MemoryReservation {
+public:
+    MemoryReservation() = default;
+    ~MemoryReservation();
+    MemoryReservation(MemoryReservation&& other) noexcept;
+    MemoryReservation& operator=(MemoryReservation&& other) noexcept;
+    MemoryReservation(const MemoryReservation&) = delete;
+    MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+    /**
+     * @brief 把预留调整为 bytes（已持有的部分计入），开始一次调用
+     * @param operation 操作名（监控用）
+     * @param bytes 所需字节数
+     * @param fallback_bytes 降级方案（half_size）所需字节数，0 表示不可降级
+     * @param token 排队期间的取消令牌
+     * @return false 表示排队期间被取消或超时，预留保持不变
+     *
+     * 按到达顺序准入：放得下时直接准入；放不下而降级方案放得下时降级；
+     * 都放不下时排队，直到其他调用结束或实例关闭。没有其他进行中的调用时
+     * 等待不会有结果，此时超出预算准入（优先降级方案）。
+     */
+    bool acquire(const std::string& operation, uint64_t bytes, uint64_t fallback_bytes = 0,
+                 const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief 结束调用：预留改为调用后实际保留的字节数（不等待），唤醒排队的申请
+     */
+    void settle(uint64_t retained_bytes);
+
+    void release();
+
+    uint64_t bytes() const;
+
+    // 最近一次 acquire() 是否按降级方案准入
+    bool downgraded() const { return downgraded_; }
+
+private:
+    uint64_t id_ = 0;
+    bool downgraded_ = false;
+};
+
+/**
+ * @brief 进程级内存预算（线程安全）
+ */
+class MemoryBudget {
+public:
+    /**
+     * @brief 设置预算；调小预算不影响已准入的调用，调大会立即唤醒排队的申请
+     */
+    static void setOptions(const MemoryBudgetOptions& options);
+
+    static MemoryBudgetOptions options();
+
+    /**
+     * @brief 当前预留与累计计数
+     */
+    static MemoryBudgetStats stats();
+
+    /**
+     * @brief 按元数据中的尺寸估算一次 LibRaw 解码及渲染的内存
+     * @param half_size 是否使用 half_size（工作图像宽高各减半）
+     */
+    static MemoryEstimate estimateDecode(const RawMetadata& metadata, bool half_size);
+
+    /**
+     * @brief 渲染一幅线性图像所需的临时内存（浮点工作图像与 RGB888 输出）
+     */
+    static uint64_t estimateRender(int width, int height);
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_MEMORY_BUDGET_H
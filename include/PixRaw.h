@@ -1,12 +1,22 @@
 #ifndef PIX_RAW_PIX_RAW_H
 #define PIX_RAW_PIX_RAW_H
 
+#include <Cancellation.h>
+#include <ColorManagement.h>
+#include <ImageSignature.h>
+#include <ImageStatistics.h>
+#include <Instrumentation.h>
+#include <MemoryBudget.h>
+#include <Prefetch.h>
 #include <RawAdjustments.h>
 #include <RawData.h>
 #include <RawImage.h>
 #include <RawMetadata.h>
+#include <Rendition.h>
+#include <SmartPreview.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace PixRaw {
 
@@ -25,7 +35,7 @@ public:
 
   /**
    * 打开 RAW 文件
-   * @param filepath 文件路径（UTF-8）
+   * @param filepath 文件路径（UTF-8）；也可以是 writeSmartPreview() 写出的智能预览
    * @return 成功返回 true
    */
   bool open(const std::string &filepath);
@@ -35,6 +45,18 @@ public:
    */
   bool open(const std::wstring &filepath);
 
+  /**
+   * 从内存缓冲区打开 RAW 数据或智能预览（不拷贝）
+   * @note 缓冲区必须在 close() 或重新打开之前保持有效
+   */
+  bool openBuffer(const void *data, size_t size);
+
+  /**
+   * 打开 PrefetchQueue 预取到内存的文件（LibRaw 从内存数据流读取，不再访问磁盘）
+   * @note 接管 file 的缓冲区，close() 或重新打开时归还给预取缓冲池
+   */
+  bool open(PrefetchedFile file);
+
   /**
    * 获取元数据
    */
@@ -44,42 +66,63 @@ public:
    * 解码为预览图（自动调整大小）
    * @param max_width 最大宽度（0 表示自适应）
    * @param max_height 最大高度（0 表示自适应）
+   * @param token 取消令牌/截止时间（所有解码调用均支持，见 getLastStatus()）
    */
-  RawImage decodePreview(int max_width = 1920, int max_height = 1080);
+  RawImage decodePreview(int max_width = 1920, int max_height = 1080,
+                         const CancellationToken &token = CancellationToken());
+
+  /**
+   * @brief 一次解码生成多个输出版本（如网页用的 2048 / 1024 / 512）
+   *
+   * 所有版本共用一次解码和一次色彩/调整渲染，随后每个版本在一次遍历中完成
+   * Lanczos 缩小、输出锐化和像素格式打包。按最大的版本决定是否使用 half_size。
+   * @return 与 specs 顺序一致；失败或取消时返回空数组
+   */
+  std::vector<RawImage> decodeRenditions(const std::vector<RenditionSpec> &specs,
+                                         const CancellationToken &token = CancellationToken());
 
   /**
    * 超快速预览（用于立即显示）
    * @return 低分辨率预览图（约 320x240），非常快
    */
-  RawImage decodeQuickPreview();
+  RawImage decodeQuickPreview(const CancellationToken &token = CancellationToken());
 
   /**
    * 中等预览（平衡质量和速度）
    * @return 中等分辨率预览图（约 1280x720）
    */
-  RawImage decodeMediumPreview();
+  RawImage decodeMediumPreview(const CancellationToken &token = CancellationToken());
 
   /**
    * 解码全尺寸图像
    */
-  RawImage decodeFull();
+  RawImage decodeFull(const CancellationToken &token = CancellationToken());
 
   /**
    * 获取缩略图（解码后的 RGB 图像）
    */
-  RawImage getThumbnail();
+  RawImage getThumbnail(const CancellationToken &token = CancellationToken());
 
   /**
    * 获取缩略图原始数据（JPEG 格式）
    * @return JPEG 数据，如果失败或不是 JPEG 格式返回空数据
    */
-  RawData getThumbnailData();
+  RawData getThumbnailData(const CancellationToken &token = CancellationToken());
 
   /**
    * 获取最后错误信息
    */
   std::string getLastError() const;
 
+  /**
+   * 获取最近一次调用的状态
+   *
+   * 取消或超时的调用返回空结果，状态为 Cancelled / DeadlineExceeded。
+   * 若取消发生在 LibRaw 的 unpack()/dcraw_process() 内部，LibRaw 会释放
+   * 已打开的文件，此时 isOpen() 为 false，需要重新 open()。
+   */
+  DecodeStatus getLastStatus() const;
+
   /**
    * 检查文件是否已打开
    */
@@ -101,6 +144,86 @@ public:
    */
   RawAdjustments getAdjustments() const;
 
+  /**
+   * @brief 设置输出色彩空间（默认 sRGB），无需重新解码
+   */
+  void setOutputColorSpace(OutputColorSpace space);
+
+  /**
+   * @brief 获取当前输出色彩空间
+   */
+  OutputColorSpace getOutputColorSpace() const;
+
+  /**
+   * @brief 启用/关闭插桩（默认关闭）
+   *
+   * 启用后每次公开调用记录各阶段耗时、读取字节数和内存统计，
+   * 并汇总到 Instrumentation 的进程级直方图。需在 open() 之前启用
+   * 才能统计读取字节数。
+   */
+  void setInstrumentationEnabled(bool enabled);
+
+  bool isInstrumentationEnabled() const;
+
+  /**
+   * @brief 启用/关闭并行解包（默认开启）
+   *
+   * 开启时 Phase One / Leaf 压缩 IIQ 按行并行解压，结果与 LibRaw 的单线程解码器一致；
+   * 其他格式不受影响。关闭时使用 LibRaw 自带的解码器（用于对比和排查）。
+   */
+  void setParallelUnpack(bool enabled);
+
+  bool isParallelUnpack() const;
+
+  /**
+   * @brief 获取最近一次调用的统计（未启用插桩时为空）
+   */
+  DecodeStats getLastStats() const;
+
+  /**
+   * @brief 设置输出统计参数（options.enabled 为 true 时，每次输出图像
+   *        在最终写出遍历中同时计算直方图、裁剪计数和均值/百分位数）
+   */
+  void setStatisticsOptions(const StatisticsOptions &options);
+
+  StatisticsOptions getStatisticsOptions() const;
+
+  /**
+   * @brief 获取最近一次输出图像的统计（未启用时为空）
+   */
+  ImageStatistics getLastStatistics() const;
+
+  /**
+   * @brief 在去马赛克之前直接统计 RAW CFA 数据（按颜色分通道，黑电平到白点归一化）
+   *
+   * 只需要解包，不运行 dcraw_process()，用于曝光分析。
+   */
+  ImageStatistics computeRawStatistics(const StatisticsOptions &options = StatisticsOptions(),
+                                       const CancellationToken &token = CancellationToken());
+
+  /**
+   * @brief 计算连拍筛选用的签名（感知哈希、颜色签名、锐度），不去马赛克
+   *
+   * 依次使用：智能预览的线性图像；长边不小于 640 的嵌入位图缩略图；
+   * 2x2 合并的 CFA 数据（只需解包）。嵌入 JPEG 缩略图需要 JPEG 解码器，不使用。
+   */
+  ImageSignature computeSignature(const CancellationToken &token = CancellationToken());
+
+  /**
+   * @brief 将当前打开的图像写为智能预览（代理文件）
+   *
+   * 智能预览保存缩小后的场景线性图像、元数据和相机色彩数据，之后可用 open()
+   * 代替原始文件打开：调整和所有 decode* 调用从代理渲染（输出尺寸不超过代理尺寸），
+   * 不再读取和解码原始 RAW。getThumbnailData() 和 computeRawStatistics() 不可用。
+   */
+  bool writeSmartPreview(const std::string &filepath, const SmartPreviewOptions &options = SmartPreviewOptions(),
+                         const CancellationToken &token = CancellationToken());
+
+  /**
+   * @brief 当前打开的是否为智能预览
+   */
+  bool isSmartPreview() const;
+
 private:
   class Impl;
   std::unique_ptr<Impl> impl_;
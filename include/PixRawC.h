@@ -0,0 +1,231 @@
+#ifndef PIX_RAW_PIX_RAW_C_H
+#define PIX_RAW_PIX_RAW_C_H
+
+/*
+ * PixRaw C API
+ *
+ * 稳定的 C ABI，供 Python / Rust 等语言绑定使用。
+ *
+ * - 所有对象均为不透明句柄，由对应的 *_destroy / *_release 释放。
+ * - pixraw_image 直接暴露解码后的像素缓冲区（行按 stride 对齐，可能含填充），
+ *   绑定层可以据此构造 NumPy / buffer protocol / 切片视图而无需拷贝；
+ *   视图存活期间持有一个引用，用完后 pixraw_image_release()。
+ * - 字符串均为 UTF-8。
+ * - 单个 pixraw_decoder 不可并发使用；不同 decoder、image、batch 之间互不影响。
+ *   pixraw_image 的引用计数是线程安全的。
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(PIX_RAW_C_EXPORTS)
+#    define PIXRAW_API __declspec(dllexport)
+#  else
+#    define PIXRAW_API __declspec(dllimport)
+#  endif
+#else
+#  define PIXRAW_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ABI 版本：结构体或函数签名不兼容变更时递增（2：pixraw_result 增加 signature） */
+#define PIXRAW_ABI_VERSION 2
+
+typedef struct pixraw_decoder pixraw_decoder;
+typedef struct pixraw_image pixraw_image;
+typedef struct pixraw_blob pixraw_blob;
+typedef struct pixraw_batch pixraw_batch;
+
+typedef enum pixraw_status {
+    PIXRAW_OK = 0,
+    PIXRAW_ERROR = 1,               /* 详见 pixraw_last_error() */
+    PIXRAW_CANCELLED = 2,
+    PIXRAW_DEADLINE_EXCEEDED = 3,
+    PIXRAW_INVALID_ARGUMENT = 4,
+    PIXRAW_PENDING = 5              /* 批处理任务尚未完成 */
+} pixraw_status;
+
+typedef enum pixraw_pixel_format {
+    PIXRAW_FORMAT_RGB888 = 0,
+    PIXRAW_FORMAT_RGBA8888 = 1,
+    PIXRAW_FORMAT_RGB565 = 2
+} pixraw_pixel_format;
+
+typedef enum pixraw_tier {
+    PIXRAW_TIER_PREVIEW = 0,        /* 按 max_width / max_height 缩放 */
+    PIXRAW_TIER_QUICK = 1,          /* 约 320x240 */
+    PIXRAW_TIER_MEDIUM = 2,         /* 约 1280x720 */
+    PIXRAW_TIER_FULL = 3,           /* 全尺寸 */
+    PIXRAW_TIER_THUMBNAIL = 4,      /* 嵌入缩略图（无位图缩略图时退回小预览） */
+    PIXRAW_TIER_SIGNATURE = 5       /* 只计算签名，不输出图像（仅批处理，见 pixraw_result.signature） */
+} pixraw_tier;
+
+/*
+ * 解码参数。调用前用 pixraw_decode_options_init() 初始化，
+ * struct_size 用于在不破坏 ABI 的前提下扩展字段。
+ */
+typedef struct pixraw_decode_options {
+    uint32_t struct_size;
+    int32_t tier;                   /* pixraw_tier */
+    int32_t max_width;              /* 仅 PIXRAW_TIER_PREVIEW 使用 */
+    int32_t max_height;
+    int32_t timeout_ms;             /* 0 表示不限时 */
+} pixraw_decode_options;
+
+typedef struct pixraw_adjustments {
+    float exposure;                 /* EV，-2 ~ 2 */
+    float contrast;                 /* -50 ~ 50 */
+    float highlights;               /* -100 ~ 100 */
+    float shadows;                  /* -100 ~ 100 */
+    float saturation;               /* -100 ~ 100 */
+    float temperature;              /* -100 ~ 100 */
+    float tint;                     /* -100 ~ 100 */
+} pixraw_adjustments;
+
+typedef struct pixraw_metadata {
+    char camera_make[64];
+    char camera_model[64];
+    char software[64];
+    char lens_model[64];
+    int32_t image_width;
+    int32_t image_height;
+    int32_t raw_width;
+    int32_t raw_height;
+    double iso;
+    double shutter_speed;           /* 秒 */
+    double aperture;
+    double focal_length;            /* mm */
+    int64_t timestamp;              /* Unix 时间戳 */
+    float wb_red;
+    float wb_green;
+    float wb_blue;
+    int32_t orientation;
+} pixraw_metadata;
+
+typedef enum pixraw_signature_source {
+    PIXRAW_SIGNATURE_NONE = 0,
+    PIXRAW_SIGNATURE_THUMBNAIL = 1,     /* 嵌入位图缩略图 */
+    PIXRAW_SIGNATURE_RAW_CFA = 2,       /* 2x2 合并的 CFA 数据 */
+    PIXRAW_SIGNATURE_SMART_PREVIEW = 3
+} pixraw_signature_source;
+
+/* 连拍筛选签名，字段含义见 C++ ImageSignature */
+typedef struct pixraw_signature {
+    uint64_t perceptual_hash;       /* 64 位 DCT 感知哈希，近似重复帧的汉明距离小 */
+    uint8_t color[48];              /* 4x4 网格平均颜色，RGB，行优先 */
+    float sharpness;                /* 拉普拉斯方差 */
+    float sharpness_peak;           /* 4x4 网格中最大的拉普拉斯方差 */
+    int32_t analysis_width;
+    int32_t analysis_height;
+    int32_t source;                 /* pixraw_signature_source */
+} pixraw_signature;
+
+/* 批处理结果 */
+typedef struct pixraw_result {
+    int64_t job;
+    pixraw_status status;
+    pixraw_image* image;            /* 成功时非空，调用者负责 pixraw_image_release() */
+    char error[256];
+    pixraw_signature signature;     /* PIXRAW_TIER_SIGNATURE 任务的结果，其他任务 source 为 NONE */
+} pixraw_result;
+
+PIXRAW_API uint32_t pixraw_abi_version(void);
+
+PIXRAW_API void pixraw_decode_options_init(pixraw_decode_options* options);
+
+/* === 解码器 === */
+
+PIXRAW_API pixraw_decoder* pixraw_create(void);
+PIXRAW_API void pixraw_destroy(pixraw_decoder* decoder);
+
+PIXRAW_API pixraw_status pixraw_open_file(pixraw_decoder* decoder, const char* path);
+
+/*
+ * 从内存打开（不拷贝）。data 必须在 pixraw_close()、重新打开或
+ * pixraw_destroy() 之前保持有效。
+ */
+PIXRAW_API pixraw_status pixraw_open_buffer(pixraw_decoder* decoder, const void* data, size_t size);
+
+PIXRAW_API void pixraw_close(pixraw_decoder* decoder);
+
+PIXRAW_API pixraw_status pixraw_get_metadata(pixraw_decoder* decoder, pixraw_metadata* out);
+
+PIXRAW_API pixraw_status pixraw_set_adjustments(pixraw_decoder* decoder, const pixraw_adjustments* adjustments);
+
+/*
+ * 解码为 RGB888 图像。options 可为 NULL（默认预览）。
+ * 成功时 *out 为新图像（引用计数 1）。
+ */
+PIXRAW_API pixraw_status pixraw_decode(pixraw_decoder* decoder, const pixraw_decode_options* options,
+                                       pixraw_image** out);
+
+/* 计算连拍筛选签名（感知哈希、颜色签名、锐度），不去马赛克 */
+PIXRAW_API pixraw_status pixraw_get_signature(pixraw_decoder* decoder, pixraw_signature* out);
+
+/* 感知哈希的汉明距离（0 ~ 64） */
+PIXRAW_API int32_t pixraw_signature_distance(const pixraw_signature* a, const pixraw_signature* b);
+
+/* 嵌入的 JPEG 缩略图字节 */
+PIXRAW_API pixraw_status pixraw_thumbnail_jpeg(pixraw_decoder* decoder, pixraw_blob** out);
+
+/* 最近一次调用的错误信息，在下一次调用该 decoder 之前有效 */
+PIXRAW_API const char* pixraw_last_error(const pixraw_decoder* decoder);
+
+/* === 图像（引用计数，借用式访问） === */
+
+PIXRAW_API const uint8_t* pixraw_image_data(const pixraw_image* image);
+PIXRAW_API int32_t pixraw_image_width(const pixraw_image* image);
+PIXRAW_API int32_t pixraw_image_height(const pixraw_image* image);
+PIXRAW_API size_t pixraw_image_stride(const pixraw_image* image);       /* 字节 */
+PIXRAW_API int32_t pixraw_image_bytes_per_pixel(const pixraw_image* image);
+PIXRAW_API size_t pixraw_image_size(const pixraw_image* image);         /* stride * height */
+PIXRAW_API pixraw_pixel_format pixraw_image_format(const pixraw_image* image);
+
+PIXRAW_API pixraw_image* pixraw_image_retain(pixraw_image* image);
+PIXRAW_API void pixraw_image_release(pixraw_image* image);
+
+/* === 字节数据 === */
+
+PIXRAW_API const uint8_t* pixraw_blob_data(const pixraw_blob* blob);
+PIXRAW_API size_t pixraw_blob_size(const pixraw_blob* blob);
+PIXRAW_API void pixraw_blob_release(pixraw_blob* blob);
+
+/* === 批处理（后台线程池） === */
+
+/* threads 为 0 时使用硬件线程数 */
+PIXRAW_API pixraw_batch* pixraw_batch_create(int32_t threads);
+
+/* 取消未开始的任务，等待正在运行的任务结束，释放未取走的结果 */
+PIXRAW_API void pixraw_batch_destroy(pixraw_batch* batch);
+
+/* 提交任务，返回任务 ID（失败返回 -1）。options 会被拷贝 */
+PIXRAW_API int64_t pixraw_batch_submit_file(pixraw_batch* batch, const char* path,
+                                            const pixraw_decode_options* options);
+
+/* data 必须在该任务的结果被取走之前保持有效 */
+PIXRAW_API int64_t pixraw_batch_submit_buffer(pixraw_batch* batch, const void* data, size_t size,
+                                              const pixraw_decode_options* options);
+
+/*
+ * 等待指定任务，最多 timeout_ms 毫秒（0 表示不等待，负数表示一直等待）。
+ * 返回 PIXRAW_OK 时 *out 为任务结果（任务随之移除）；
+ * 超时返回 PIXRAW_PENDING；未知任务、或等待期间结果已被其他 poll 取走时返回 PIXRAW_INVALID_ARGUMENT。
+ */
+PIXRAW_API pixraw_status pixraw_batch_poll(pixraw_batch* batch, int64_t job, int32_t timeout_ms,
+                                           pixraw_result* out);
+
+/* 按完成顺序取走任一已完成任务，语义同 pixraw_batch_poll() */
+PIXRAW_API pixraw_status pixraw_batch_poll_any(pixraw_batch* batch, int32_t timeout_ms, pixraw_result* out);
+
+/* 取消任务（未开始的直接完成为 PIXRAW_CANCELLED，运行中的协作式取消） */
+PIXRAW_API void pixraw_batch_cancel(pixraw_batch* batch, int64_t job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIX_RAW_PIX_RAW_C_H */
@@ -0,0 +1,96 @@
+#ifndef RAW_PROCESSOR_PLANAR_IMAGE_H
+#define RAW_PROCESSOR_PLANAR_IMAGE_H
+
+#include <Cancellation.h>
+#include <ImageStatistics.h>
+#include <RawImage.h>
+#include <memory>
+#include <cstdint>
+
+namespace PixRaw {
+
+/**
+ * @brief 平面（SoA）浮点 RGB 图像
+ *
+ * 解码与最终输出之间的内部工作格式：R/G/B 分别存放在独立的平面中，
+ * 取值范围 [0, 1]。每个平面的行按 64 字节对齐，处理内核可以逐平面
+ * 连续读写而无需通道重排；只在输出边界转换为交错的 PixelFormat。
+ */
+class PlanarImage {
+public:
+    static constexpr int kChannels = 3;
+
+    PlanarImage();
+    PlanarImage(int width, int height);
+    ~PlanarImage();
+
+    // 禁止拷贝
+    PlanarImage(const PlanarImage&) = delete;
+    PlanarImage& operator=(const PlanarImage&) = delete;
+
+    // 移动
+    PlanarImage(PlanarImage&&) noexcept;
+    PlanarImage& operator=(PlanarImage&&) noexcept;
+
+    /**
+     * @brief 从交错的 RawImage 转换（支持 RGB888 / RGBA8888 / RGB565）
+     */
+    static PlanarImage fromInterleaved(const RawImage& image);
+
+    /**
+     * @brief 从紧密排列的 RGB 数据转换（LibRaw 输出，8 或 16 位）
+     */
+    static PlanarImage fromPacked(const void* data, int width, int height, int bits);
+
+    /**
+     * @brief 量化并交错输出为指定像素格式
+     * @param stats 非空且 options.enabled 时，在同一次写出遍历中计算统计
+     * @param token 按行带检查取消，取消后返回空图像
+     */
+    RawImage toInterleaved(PixelFormat format, ImageStatistics* stats = nullptr,
+                           const StatisticsOptions& options = StatisticsOptions(),
+                           const CancellationToken& token = CancellationToken()) const;
+
+    /**
+     * @brief 将区域 (x, y, width, height) 缩放到 dst 的尺寸写入 dst
+     *
+     * 缩小时按面积平均（盒式滤波），放大时取最近邻。区域需位于图像内。
+     */
+    void resampleInto(PlanarImage& dst, int x, int y, int width, int height,
+                      const CancellationToken& token = CancellationToken()) const;
+
+    // 深拷贝
+    PlanarImage clone() const;
+
+    // 平面访问（channel: 0=R, 1=G, 2=B）
+    float* plane(int channel) { return data_ + static_cast<size_t>(channel) * planeSize(); }
+    const float* plane(int channel) const { return data_ + static_cast<size_t>(channel) * planeSize(); }
+
+    float* row(int channel, int y) { return plane(channel) + static_cast<size_t>(y) * stride_; }
+    const float* row(int channel, int y) const { return plane(channel) + static_cast<size_t>(y) * stride_; }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int stride() const { return stride_; }  // 以 float 为单位
+
+    // 三个平面占用的总字节数
+    size_t byteSize() const { return planeSize() * kChannels * sizeof(float); }
+
+    bool isValid() const { return data_ != nullptr; }
+
+    // 交换
+    void swap(PlanarImage& other) noexcept;
+
+private:
+    size_t planeSize() const { return static_cast<size_t>(stride_) * height_; }
+
+    int width_ = 0;
+    int height_ = 0;
+    int stride_ = 0;
+    std::shared_ptr<float> buffer_;
+    float* data_ = nullptr;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_PLANAR_IMAGE_H
@@ -0,0 +1,121 @@
+#ifndef RAW_PROCESSOR_PREFETCH_H
+#define RAW_PROCESSOR_PREFETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PixRaw {
+
+class PrefetchBufferPool;
+
+/**
+ * @brief 预取参数
+ */
+struct PrefetchOptions {
+    int depth = 4;            // 预取深度：已读入（或正在读取）但尚未被 next() 取走的文件数上限
+    int io_threads = 2;       // 读取线程数
+    int advise_ahead = 8;     // 预取窗口之后再提前多少个文件发出 POSIX_FADV_WILLNEED（0 关闭）
+    bool drop_cache = false;  // 读完后 POSIX_FADV_DONTNEED，一次性导入时避免挤占页缓存
+};
+
+/**
+ * @brief 预取统计（I/O 与计算的重叠）
+ */
+struct PrefetchStats {
+    uint64_t files = 0;               // 已交付的文件数（含失败）
+    uint64_t failed = 0;              // 读取失败的文件数
+    uint64_t bytes_read = 0;
+    double read_ms = 0.0;             // 读取线程累计的读取耗时（各线程之和）
+    double wait_ms = 0.0;             // 调用者在 next() 中等待 I/O 的时间
+    double compute_ms = 0.0;          // 调用者在两次 next() 之间的时间（解码等）
+    double wall_ms = 0.0;             // 第一次 next() 到最近一次 next() 返回
+    uint64_t buffers_allocated = 0;   // 缓冲池新分配（或扩容）的次数
+    uint64_t buffers_reused = 0;      // 直接复用池中缓冲区的次数
+
+    /**
+     * @brief 被计算掩盖的 I/O 比例：1 - wait_ms / read_ms（[0, 1]，没有读取时为 0）
+     */
+    double overlap() const;
+};
+
+/**
+ * @brief 预取到内存的文件
+ *
+ * 持有缓冲池中的一块缓冲区，析构时归还给池（队列已销毁时直接释放）。
+ * 可以移动，移动不改变 data() 指针。
+ */
+class PrefetchedFile {
+public:
+    PrefetchedFile();
+    ~PrefetchedFile();
+
+    PrefetchedFile(PrefetchedFile&& other) noexcept;
+    PrefetchedFile& operator=(PrefetchedFile&& other) noexcept;
+
+    // 禁止拷贝
+    PrefetchedFile(const PrefetchedFile&) = delete;
+    PrefetchedFile& operator=(const PrefetchedFile&) = delete;
+
+    const std::string& path() const { return path_; }
+    const uint8_t* data() const { return data_.get(); }
+    size_t size() const { return size_; }
+
+    // 读取成功时为 true；失败时 error() 为错误信息
+    bool isValid() const { return data_ != nullptr && error_.empty(); }
+    const std::string& error() const { return error_; }
+
+private:
+    friend class PrefetchQueue;
+    friend class PrefetchBufferPool;
+
+    void release();
+
+    std::string path_;
+    std::string error_;
+    std::unique_ptr<uint8_t[]> data_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    std::shared_ptr<PrefetchBufferPool> pool_;
+};
+
+/**
+ * @brief 目录级导入的异步预取队列
+ *
+ * 后台读取线程按顺序把接下来的文件整块读入池化缓冲区（POSIX 上先对更靠后的文件
+ * 发出 POSIX_FADV_WILLNEED，让内核提前预读），调用者解码当前文件的同时
+ * I/O 持续进行。取出的文件通过 PixRaw::open(PrefetchedFile) 交给 LibRaw 的
+ * 内存数据流，解码时不再阻塞在文件读取上。
+ *
+ * next() 按构造时的顺序返回文件，只应由一个线程调用。
+ */
+class PrefetchQueue {
+public:
+    explicit PrefetchQueue(std::vector<std::string> paths, const PrefetchOptions& options = PrefetchOptions());
+    ~PrefetchQueue();
+
+    // 禁止拷贝
+    PrefetchQueue(const PrefetchQueue&) = delete;
+    PrefetchQueue& operator=(const PrefetchQueue&) = delete;
+
+    /**
+     * @brief 取出下一个文件（未读完时阻塞）
+     * @param file 输出；读取失败时 file.isValid() 为 false，可继续取下一个
+     * @return 所有文件都已取出时返回 false
+     */
+    bool next(PrefetchedFile& file);
+
+    size_t size() const;
+
+    PrefetchStats stats() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_PREFETCH_H
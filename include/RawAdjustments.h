@@ -16,6 +16,10 @@ struct RawAdjustments {
     float shadows = 0.0f;       // 阴影 (-100 ~ 100)
     float saturation = 0.0f;    // 饱和度 (-100 ~ 100)
     float temperature = 0.0f;   // 色温 (-100 ~ 100, 负数=冷, 正数=暖)
+    float tint = 0.0f;          // 色调 (-100 ~ 100, 负数=偏绿, 正数=偏品红)
+
+    // 白平衡倍率（相机 RGB，语义同 LibRaw 的 user_mul；全 0 表示使用拍摄时白平衡）
+    float wb_multipliers[3] = {0.0f, 0.0f, 0.0f};
 
     // 是否启用了任何调整
     bool hasAdjustments() const {
@@ -24,7 +28,24 @@ struct RawAdjustments {
                highlights != 0.0f ||
                shadows != 0.0f ||
                saturation != 0.0f ||
-               temperature != 0.0f;
+               temperature != 0.0f ||
+               tint != 0.0f ||
+               hasCustomWhiteBalance();
+    }
+
+    // 是否指定了自定义白平衡
+    bool hasCustomWhiteBalance() const {
+        return wb_multipliers[0] > 0.0f && wb_multipliers[1] > 0.0f && wb_multipliers[2] > 0.0f;
+    }
+
+    // 显示参考部分：去掉在线性数据上处理的曝光、白平衡、色温和色调
+    RawAdjustments displayReferred() const {
+        RawAdjustments display = *this;
+        display.exposure = 0.0f;
+        display.temperature = 0.0f;
+        display.tint = 0.0f;
+        display.wb_multipliers[0] = display.wb_multipliers[1] = display.wb_multipliers[2] = 0.0f;
+        return display;
     }
 
     // 重置所有参数
@@ -35,6 +56,8 @@ struct RawAdjustments {
         shadows = 0.0f;
         saturation = 0.0f;
         temperature = 0.0f;
+        tint = 0.0f;
+        wb_multipliers[0] = wb_multipliers[1] = wb_multipliers[2] = 0.0f;
     }
 };
 
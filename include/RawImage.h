@@ -15,8 +15,16 @@ enum class PixelFormat {
 
 class RawImage {
 public:
+    // 默认行对齐（字节），保证每行起始地址可用于对齐的 SIMD 加载
+    static constexpr int kDefaultAlignment = 64;
+
     RawImage();
-    RawImage(int width, int height, PixelFormat format);
+
+    /**
+     * @brief 分配图像
+     * @param alignment 行对齐字节数（2 的幂），行跨度向上取整到该值；1 表示紧密排列
+     */
+    RawImage(int width, int height, PixelFormat format, int alignment = kDefaultAlignment);
     ~RawImage();
 
     // 禁止拷贝
@@ -27,13 +35,22 @@ public:
     RawImage(RawImage&&) noexcept;
     RawImage& operator=(RawImage&&) noexcept;
 
+    /**
+     * @brief 包装外部缓冲区（不拥有数据，调用者负责其生命周期）
+     */
+    static RawImage wrap(uint8_t* data, int width, int height, int stride, PixelFormat format);
+
     // 数据访问
-    uint8_t* data() { return data_.get(); }
-    const uint8_t* data() const { return data_.get(); }
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+
+    // 行访问（按 stride 寻址）
+    uint8_t* row(int y) { return data_ + static_cast<size_t>(y) * stride_; }
+    const uint8_t* row(int y) const { return data_ + static_cast<size_t>(y) * stride_; }
 
     // 兼容性：void* 版本
-    void* dataVoid() { return data_.get(); }
-    const void* dataVoid() const { return data_.get(); }
+    void* dataVoid() { return data_; }
+    const void* dataVoid() const { return data_; }
 
     int width() const { return width_; }
     int height() const { return height_; }
@@ -41,6 +58,18 @@ public:
     PixelFormat format() const { return format_; }
     int bytesPerPixel() const;
 
+    // 每行有效像素字节数（不含填充）
+    int rowBytes() const { return width_ * bytesPerPixel(); }
+
+    // 像素缓冲区占用字节数（含行尾填充）
+    size_t byteSize() const { return static_cast<size_t>(stride_) * height_; }
+
+    // 行之间无填充，可按连续缓冲区访问
+    bool isContiguous() const { return stride_ == rowBytes(); }
+
+    // 是否为视图（与其他图像共享或借用数据）
+    bool isView() const { return view_; }
+
     // 保存为文件
     bool save(const std::string& filepath, int quality = 90) const;
 
@@ -50,6 +79,19 @@ public:
     // 缩放
     RawImage resize(int new_width, int new_height) const;
 
+    /**
+     * @brief 裁剪视图（零拷贝，与原图共享数据，写入视图会修改原图）
+     * @return 区域越界时返回空图像
+     *
+     * 视图可写，因此只能从非 const 图像创建；只读图像需要区域副本时先 clone()。
+     */
+    RawImage crop(int x, int y, int width, int height);
+
+    /**
+     * @brief 深拷贝为独立、按默认对齐分配的图像
+     */
+    RawImage clone() const;
+
     // 有效检查
     bool isValid() const { return data_ != nullptr; }
 
@@ -61,7 +103,9 @@ private:
     int height_ = 0;
     int stride_ = 0;
     PixelFormat format_ = PixelFormat::RGB888;
-    std::unique_ptr<uint8_t[]> data_;
+    bool view_ = false;
+    std::shared_ptr<uint8_t> buffer_;  // 对齐分配的底层缓冲区（外部包装时为空）
+    uint8_t* data_ = nullptr;          // 首行首像素
 };
 
 } // namespace PixRaw
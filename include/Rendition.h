@@ -0,0 +1,59 @@
+#ifndef RAW_PROCESSOR_RENDITION_H
+#define RAW_PROCESSOR_RENDITION_H
+
+#include <Cancellation.h>
+#include <PlanarImage.h>
+#include <RawImage.h>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 输出版本参数（如网页用的 2048 / 1024 / 512）
+ */
+struct RenditionSpec {
+    // 输出尺寸上限，保持宽高比、不放大；0 表示不限制
+    int max_width = 2048;
+    int max_height = 2048;
+
+    PixelFormat format = PixelFormat::RGBA8888;
+
+    // 输出锐化（USM，只作用于亮度，避免彩色镶边）
+    float sharpen_amount = 0.6f;     // 强度，0 关闭
+    float sharpen_radius = 0.6f;     // 高斯 sigma（输出像素）
+    float sharpen_threshold = 0.0f;  // 亮度差（[0, 1]）小于该值的细节不锐化，避免放大噪声
+};
+
+/**
+ * @brief 输出版本生成器
+ *
+ * 一次遍历完成高质量缩小（可分离 Lanczos-3，缩小时按比例展宽核）、USM 输出锐化
+ * 和像素格式打包：按 32 行输出行带并行，每个行带在线程局部缓冲区中先横向
+ * 再纵向缩放（只读取一次该行带需要的源行），随后锐化并直接写出目标格式，
+ * 中间不生成整幅图像。
+ */
+class RenditionRenderer {
+public:
+    /**
+     * @brief 计算输出尺寸（保持宽高比、不放大）
+     */
+    static void outputSize(int width, int height, const RenditionSpec& spec, int& out_width, int& out_height);
+
+    /**
+     * @brief 由显示编码的平面图像（[0, 1]）生成一个输出版本
+     * @return 失败或取消时返回空图像
+     */
+    static RawImage render(const PlanarImage& source, const RenditionSpec& spec,
+                           const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief 由同一幅图像生成多个输出版本（与 specs 顺序一致）
+     * @return 取消时返回空数组
+     */
+    static std::vector<RawImage> render(const PlanarImage& source, const std::vector<RenditionSpec>& specs,
+                                        const CancellationToken& token = CancellationToken());
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_RENDITION_H
@@ -0,0 +1,139 @@
+#ifndef RAW_PROCESSOR_SHARED_RAW_H
+#define RAW_PROCESSOR_SHARED_RAW_H
+
+#include <Cancellation.h>
+#include <ColorManagement.h>
+#include <HalfPlanarImage.h>
+#include <ImageStatistics.h>
+#include <PlanarImage.h>
+#include <RawAdjustments.h>
+#include <RawImage.h>
+#include <RawMetadata.h>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace PixRaw {
+
+/**
+ * @brief 渲染请求
+ */
+struct RenderRequest {
+    // 区域（全尺寸输出坐标，已应用方向）；width/height 为 0 表示到图像边缘
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+
+    // 输出尺寸上限，保持宽高比、不放大；0 表示不限制
+    int max_width = 0;
+    int max_height = 0;
+
+    RawAdjustments adjustments;
+    OutputColorSpace output_space = OutputColorSpace::sRGB;
+    PixelFormat format = PixelFormat::RGB888;
+    StatisticsOptions statistics;
+};
+
+/**
+ * @brief 共享的已打开 RAW（线程安全、对外不可变）
+ *
+ * 文件只解析和解包一次。线性图像按需以 half_size / 全尺寸两档解码，
+ * 各档只解码一次并以半精度平面在所有使用者之间共享（只读；解码被取消时重新打开文件，
+ * 由下一个请求重新解码）。多个线程可以同时
+ * 通过各自的 RenderContext 请求不同尺寸、区域和调整参数。
+ */
+class SharedRaw {
+public:
+    /**
+     * @brief 线性图像及其对应的相机矩阵
+     */
+    struct LinearImage {
+        std::shared_ptr<const HalfPlanarImage> image;
+        CameraColor camera;
+    };
+
+    /**
+     * @brief 打开并解包 RAW 文件
+     * @param error 失败时写入错误信息（可为空）
+     */
+    static std::shared_ptr<const SharedRaw> open(const std::string& filepath, std::string* error = nullptr);
+
+    /**
+     * @brief 从内存打开并解包（不拷贝，缓冲区在 SharedRaw 存活期间必须保持有效）
+     */
+    static std::shared_ptr<const SharedRaw> openBuffer(const void* data, size_t size, std::string* error = nullptr);
+
+    ~SharedRaw();
+
+    // 禁止拷贝
+    SharedRaw(const SharedRaw&) = delete;
+    SharedRaw& operator=(const SharedRaw&) = delete;
+
+    const RawMetadata& metadata() const;
+
+    // 全尺寸输出的宽高（已应用方向）
+    int width() const;
+    int height() const;
+
+    /**
+     * @brief 获取线性图像（首次请求某档时解码，之后直接返回共享的缓存）
+     * @param half_size true 为半尺寸档（跳过去马赛克，较快）
+     * @param token 取消解码，或放弃等待其他请求的解码；取消的解码不缓存，之后的请求重新解码
+     * @return 失败或取消时 image 为空
+     *
+     * 解码前按 MemoryBudget 估算向进程级预算申请（不降级），RAW 数据和已缓存的档位
+     * 在对象存活期间保留在预算中。
+     */
+    LinearImage linearImage(bool half_size, std::string* error = nullptr,
+                            const CancellationToken& token = CancellationToken()) const;
+
+private:
+    SharedRaw();
+
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+/**
+ * @brief 每线程的渲染上下文
+ *
+ * 持有可复用的工作缓冲区和最近一次的状态，不与其他线程共享；
+ * 同一个 SharedRaw 可被任意多个 RenderContext 并发使用。
+ */
+class RenderContext {
+public:
+    RenderContext();
+    ~RenderContext();
+
+    // 禁止拷贝
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+
+    /**
+     * @brief 渲染区域：裁剪 + 缩放 -> 色彩 LUT -> 调整 -> 输出格式
+     *
+     * 输出不超过全尺寸一半时使用半尺寸档的线性图像。
+     */
+    RawImage render(const SharedRaw& raw, const RenderRequest& request,
+                    const CancellationToken& token = CancellationToken());
+
+    // 最近一次输出的统计（request.statistics.enabled 为 true 时有效）
+    const ImageStatistics& getLastStatistics() const { return statistics_; }
+
+    std::string getLastError() const { return error_; }
+    DecodeStatus getLastStatus() const { return status_; }
+
+private:
+    void fail(const std::string& message);
+    bool cancelled(const CancellationToken& token);
+
+    PlanarImage working_;       // 复用的工作图像（尺寸不变时不重新分配）
+    ImageStatistics statistics_;
+    std::string error_;
+    DecodeStatus status_ = DecodeStatus::Success;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_SHARED_RAW_H
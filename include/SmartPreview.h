@@ -0,0 +1,103 @@
+#ifndef RAW_PROCESSOR_SMART_PREVIEW_H
+#define RAW_PROCESSOR_SMART_PREVIEW_H
+
+#include <Cancellation.h>
+#include <ColorManagement.h>
+#include <HalfPlanarImage.h>
+#include <RawMetadata.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PixRaw {
+
+/**
+ * @brief 智能预览编码参数
+ */
+struct SmartPreviewOptions {
+    int long_edge = 2560;   // 长边像素数（不放大原图）
+    bool lossy = false;     // true：sqrt 域量化到 12 位（步长接近感知均匀），体积更小
+};
+
+/**
+ * @brief 智能预览（代理文件）
+ *
+ * 保存缩小后的场景线性、已去马赛克的图像，以及 RawMetadata 和相机色彩数据，
+ * 离线编辑时代替原始 RAW 文件。PixRaw::open() 识别该格式，调整和预览
+ * 直接从代理渲染。
+ *
+ * 文件布局（小端）：64 字节文件头 | 元数据 | 行带索引 | 各行带各通道的压缩数据。
+ * 每 64 行为一个行带，每个通道独立压缩（MED 预测 + 自适应 Rice 编码），
+ * 按 8 字节对齐；打开时整个文件以 mmap 映射，按行带并行解码。
+ */
+class SmartPreview {
+public:
+    ~SmartPreview();
+
+    // 禁止拷贝
+    SmartPreview(const SmartPreview&) = delete;
+    SmartPreview& operator=(const SmartPreview&) = delete;
+
+    /**
+     * @brief 检查数据开头是否为智能预览文件头
+     */
+    static bool isSmartPreview(const void* data, size_t size);
+
+    /**
+     * @brief 检查文件是否为智能预览（只读取文件头）
+     */
+    static bool isSmartPreviewFile(const std::string& filepath);
+
+    /**
+     * @brief 编码为智能预览（image 为场景线性相机 RGB，按原样编码，不缩放）
+     * @return 编码后的文件内容，失败时为空
+     */
+    static std::vector<uint8_t> encode(const HalfPlanarImage& image, const RawMetadata& metadata,
+                                       const CameraColor& camera, bool lossy,
+                                       const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief 编码并写入文件
+     */
+    static bool write(const std::string& filepath, const HalfPlanarImage& image, const RawMetadata& metadata,
+                      const CameraColor& camera, bool lossy, std::string* error = nullptr,
+                      const CancellationToken& token = CancellationToken());
+
+    /**
+     * @brief 打开智能预览文件（mmap 映射，不读入整个文件）
+     * @param error 失败时写入错误信息（可为空）
+     */
+    static std::unique_ptr<SmartPreview> open(const std::string& filepath, std::string* error = nullptr);
+
+    /**
+     * @brief 从内存打开（不拷贝，缓冲区在 SmartPreview 存活期间必须保持有效）
+     */
+    static std::unique_ptr<SmartPreview> openBuffer(const void* data, size_t size, std::string* error = nullptr);
+
+    const RawMetadata& metadata() const;
+    const CameraColor& camera() const;
+
+    // 代理图像尺寸
+    int width() const;
+    int height() const;
+
+    bool isLossy() const;
+
+    /**
+     * @brief 解码图像（按行带并行）
+     * @return 失败或取消时返回无效图像
+     */
+    HalfPlanarImage decode(const CancellationToken& token = CancellationToken(), std::string* error = nullptr) const;
+
+private:
+    SmartPreview();
+
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_SMART_PREVIEW_H
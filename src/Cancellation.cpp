@@ -0,0 +1,92 @@
+#include "Cancellation.h"
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace PixRaw {
+
+struct CancellationToken::State {
+    std::atomic<bool> cancelled{false};
+    bool has_deadline = false;
+    Clock::time_point deadline;
+
+    std::mutex mutex;   // 保护监听列表，并保证 removeListener() 返回后监听不再执行
+    std::vector<std::pair<int, std::function<void()>>> listeners;
+    int next_id = 0;
+};
+
+CancellationToken CancellationToken::create() {
+    CancellationToken token;
+    token.state_ = std::make_shared<State>();
+    return token;
+}
+
+CancellationToken CancellationToken::withDeadline(Clock::time_point deadline) {
+    CancellationToken token = create();
+    token.state_->has_deadline = true;
+    token.state_->deadline = deadline;
+    return token;
+}
+
+CancellationToken CancellationToken::withTimeout(std::chrono::milliseconds timeout) {
+    return withDeadline(Clock::now() + timeout);
+}
+
+void CancellationToken::cancel() const {
+    if (!state_ || state_->cancelled.exchange(true)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    for (auto& entry : state_->listeners) {
+        entry.second();
+    }
+}
+
+bool CancellationToken::isCancelled() const {
+    return status() != DecodeStatus::Success;
+}
+
+DecodeStatus CancellationToken::status() const {
+    if (!state_) {
+        return DecodeStatus::Success;
+    }
+    if (state_->cancelled.load(std::memory_order_acquire)) {
+        return DecodeStatus::Cancelled;
+    }
+    if (state_->has_deadline && Clock::now() >= state_->deadline) {
+        return DecodeStatus::DeadlineExceeded;
+    }
+    return DecodeStatus::Success;
+}
+
+int CancellationToken::addListener(std::function<void()> listener) const {
+    if (!state_ || !listener) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    if (state_->cancelled.load(std::memory_order_acquire)) {
+        listener();
+    }
+    int id = state_->next_id++;
+    state_->listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void CancellationToken::removeListener(int id) const {
+    if (!state_ || id < 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto& listeners = state_->listeners;
+    for (auto it = listeners.begin(); it != listeners.end(); ++it) {
+        if (it->first == id) {
+            listeners.erase(it);
+            break;
+        }
+    }
+}
+
+} // namespace PixRaw
@@ -0,0 +1,431 @@
+#include "ColorManagement.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace PixRaw {
+
+namespace {
+
+using Mat3 = std::array<std::array<double, 3>, 3>;
+using Vec3 = std::array<double, 3>;
+
+constexpr size_t kMaxCachedLuts = 32;
+
+Mat3 multiply(const Mat3& a, const Mat3& b) {
+    Mat3 r{};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 3; ++k)
+                r[i][j] += a[i][k] * b[k][j];
+    return r;
+}
+
+Vec3 multiply(const Mat3& m, const Vec3& v) {
+    Vec3 r{};
+    for (int i = 0; i < 3; ++i)
+        r[i] = m[i][0] * v[0] + m[i][1] * v[1] + m[i][2] * v[2];
+    return r;
+}
+
+bool invert(const Mat3& m, Mat3& out) {
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                 m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                 m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (std::fabs(det) < 1e-12) {
+        return false;
+    }
+    double inv = 1.0 / det;
+    out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+    out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+    out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+    out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    return true;
+}
+
+Mat3 identityMatrix() {
+    return Mat3{{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}};
+}
+
+// xy 色度 -> XYZ（Y = 1）
+Vec3 xyToXyz(double x, double y) {
+    return Vec3{x / y, 1.0, (1.0 - x - y) / y};
+}
+
+// 由原色和白点（xy）计算 RGB -> XYZ 矩阵
+Mat3 rgbToXyz(const double primaries[3][2], double wx, double wy) {
+    Mat3 p{};
+    for (int c = 0; c < 3; ++c) {
+        Vec3 xyz = xyToXyz(primaries[c][0], primaries[c][1]);
+        for (int i = 0; i < 3; ++i) p[i][c] = xyz[i];
+    }
+    Mat3 p_inv;
+    invert(p, p_inv);
+    Vec3 s = multiply(p_inv, xyToXyz(wx, wy));
+    for (int i = 0; i < 3; ++i)
+        for (int c = 0; c < 3; ++c)
+            p[i][c] *= s[c];
+    return p;
+}
+
+const double kD65x = 0.3127;
+const double kD65y = 0.3290;
+
+const double kSrgbPrimaries[3][2] = {{0.640, 0.330}, {0.300, 0.600}, {0.150, 0.060}};
+const double kP3Primaries[3][2] = {{0.680, 0.320}, {0.265, 0.690}, {0.150, 0.060}};
+const double kAdobePrimaries[3][2] = {{0.640, 0.330}, {0.210, 0.710}, {0.150, 0.060}};
+const double kRec2020Primaries[3][2] = {{0.708, 0.292}, {0.170, 0.797}, {0.131, 0.046}};
+
+// 线性 sRGB -> 目标原色（所有目标空间白点均为 D65，无需色适应）
+Mat3 srgbToOutput(OutputColorSpace space) {
+    const double (*primaries)[2] = nullptr;
+    switch (space) {
+        case OutputColorSpace::sRGB:
+        case OutputColorSpace::Linear:
+            return identityMatrix();
+        case OutputColorSpace::DisplayP3: primaries = kP3Primaries; break;
+        case OutputColorSpace::AdobeRGB: primaries = kAdobePrimaries; break;
+        case OutputColorSpace::Rec2020: primaries = kRec2020Primaries; break;
+    }
+    Mat3 xyz_to_out;
+    invert(rgbToXyz(primaries, kD65x, kD65y), xyz_to_out);
+    return multiply(xyz_to_out, rgbToXyz(kSrgbPrimaries, kD65x, kD65y));
+}
+
+// 线性值 -> 输出编码
+double encode(OutputColorSpace space, double v) {
+    switch (space) {
+        case OutputColorSpace::sRGB:
+        case OutputColorSpace::DisplayP3:
+            return v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+        case OutputColorSpace::AdobeRGB:
+            return std::pow(v, 256.0 / 563.0);
+        case OutputColorSpace::Rec2020:
+            return v < 0.018053968510807 ? 4.5 * v : 1.09929682680944 * std::pow(v, 0.45) - 0.09929682680944;
+        case OutputColorSpace::Linear:
+            return v;
+    }
+    return v;
+}
+
+// 色温 (K) -> 普朗克轨迹 xy（Kim et al. 三次样条近似，1667K ~ 25000K）
+void cctToXy(double t, double& x, double& y) {
+    t = std::min(std::max(t, 1667.0), 25000.0);
+    double t2 = t * t;
+    double t3 = t2 * t;
+    if (t <= 4000.0) {
+        x = -0.2661239e9 / t3 - 0.2343589e6 / t2 + 0.8776956e3 / t + 0.179910;
+    } else {
+        x = -3.0258469e9 / t3 + 2.1070379e6 / t2 + 0.2226347e3 / t + 0.240390;
+    }
+    double x2 = x * x;
+    double x3 = x2 * x;
+    if (t <= 2222.0) {
+        y = -1.1063814 * x3 - 1.34811020 * x2 + 2.18555832 * x - 0.20219683;
+    } else if (t <= 4000.0) {
+        y = -0.9549476 * x3 - 1.37418593 * x2 + 2.09137015 * x - 0.16748867;
+    } else {
+        y = 3.0817580 * x3 - 5.87338670 * x2 + 3.75112997 * x - 0.37001483;
+    }
+}
+
+// 某色温光源在（已按拍摄白平衡校正的）相机空间中的响应
+Vec3 cameraResponse(const Mat3& cam_from_srgb, double kelvin) {
+    double x, y;
+    cctToXy(kelvin, x, y);
+    Mat3 srgb_from_xyz;
+    invert(rgbToXyz(kSrgbPrimaries, kD65x, kD65y), srgb_from_xyz);
+    return multiply(cam_from_srgb, multiply(srgb_from_xyz, xyToXyz(x, y)));
+}
+
+/**
+ * 相机空间的色温/色调倍率
+ *
+ * 滑块映射为相对参考色温的 mired 偏移（±100 mired），倍率为参考光源与
+ * 偏移光源在相机空间响应之比：正值按更冷的光源校正，画面变暖。
+ * 色调只作用于绿色通道。
+ */
+Vec3 whiteBalanceMultipliers(const Mat3& rgb_cam, float temperature, float tint) {
+    Vec3 m{1.0, 1.0, 1.0};
+
+    Mat3 cam_from_srgb;
+    if (temperature != 0.0f && invert(rgb_cam, cam_from_srgb)) {
+        const double reference_mired = 1e6 / 6504.0;
+        double mired = std::min(std::max(reference_mired - temperature, 40.0), 500.0);
+
+        Vec3 ref = cameraResponse(cam_from_srgb, 1e6 / reference_mired);
+        Vec3 src = cameraResponse(cam_from_srgb, 1e6 / mired);
+        for (int c = 0; c < 3; ++c) {
+            m[c] = (src[c] > 1e-6 && ref[c] > 0.0) ? ref[c] / src[c] : 1.0;
+        }
+        // 保持绿色通道不变
+        double g = m[1];
+        for (int c = 0; c < 3; ++c) m[c] /= g;
+    }
+
+    m[1] *= std::pow(2.0, -tint / 200.0);
+    return m;
+}
+
+/**
+ * 场景参考增益：曝光与自定义白平衡
+ *
+ * 缓存的线性图像已按 cam_mul 做过白平衡，自定义倍率（user_mul 语义）
+ * 换算为相对 cam_mul 的比值；两者都按绿色归一化，只改变色彩不改变亮度。
+ */
+Vec3 sceneGains(const CameraColor& camera, const ColorSettings& settings) {
+    double gain = std::pow(2.0, settings.exposure);
+    Vec3 m{gain, gain, gain};
+
+    const float* wb = settings.white_balance;
+    const float* cam = camera.cam_mul;
+    if (wb[0] > 0.0f && wb[1] > 0.0f && wb[2] > 0.0f &&
+        cam[0] > 0.0f && cam[1] > 0.0f && cam[2] > 0.0f) {
+        for (int c = 0; c < 3; ++c) {
+            m[c] *= (static_cast<double>(wb[c]) / wb[1]) / (static_cast<double>(cam[c]) / cam[1]);
+        }
+    }
+    return m;
+}
+
+struct LutKey {
+    std::array<float, 9> matrix;
+    std::array<float, 3> cam_mul;
+    int space;
+    float exposure;
+    std::array<float, 3> white_balance;
+    float temperature;
+    float tint;
+    int size;
+
+    bool operator<(const LutKey& other) const {
+        return std::tie(matrix, cam_mul, space, exposure, white_balance, temperature, tint, size) <
+               std::tie(other.matrix, other.cam_mul, other.space, other.exposure, other.white_balance,
+                        other.temperature, other.tint, other.size);
+    }
+};
+
+std::mutex& cacheMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::map<LutKey, std::shared_ptr<const ColorLut3D>>& lutCache() {
+    static std::map<LutKey, std::shared_ptr<const ColorLut3D>> cache;
+    return cache;
+}
+
+} // namespace
+
+// === ColorSettings 实现 ===
+
+ColorSettings ColorSettings::sceneReferred(const RawAdjustments& adjustments, OutputColorSpace output_space) {
+    ColorSettings settings;
+    settings.output_space = output_space;
+    settings.exposure = adjustments.exposure;
+    if (adjustments.hasCustomWhiteBalance()) {
+        for (int c = 0; c < 3; ++c) {
+            settings.white_balance[c] = adjustments.wb_multipliers[c];
+        }
+    }
+    settings.temperature = adjustments.temperature;
+    settings.tint = adjustments.tint;
+    return settings;
+}
+
+// === ColorLut3D 实现 ===
+
+ColorLut3D ColorLut3D::build(const CameraColor& camera, const ColorSettings& settings) {
+    ColorLut3D lut;
+    int n = std::min(std::max(settings.lut_size, 2), 129);
+
+    Mat3 rgb_cam{};
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            rgb_cam[i][j] = camera.rgb_cam[i][j];
+
+    // 合成：场景增益 -> 相机倍率 -> 相机矩阵 -> 输出原色
+    Vec3 gains = sceneGains(camera, settings);
+    Vec3 wb = whiteBalanceMultipliers(rgb_cam, settings.temperature, settings.tint);
+    Mat3 total = multiply(srgbToOutput(settings.output_space), rgb_cam);
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            total[i][j] *= wb[j] * gains[j];
+
+    lut.size_ = n;
+    lut.table_.resize(static_cast<size_t>(n) * n * n * 3);
+
+    float* out = lut.table_.data();
+    for (int ir = 0; ir < n; ++ir) {
+        for (int ig = 0; ig < n; ++ig) {
+            for (int ib = 0; ib < n; ++ib) {
+                // 节点位于 sqrt 整形域，还原为线性输入
+                double sr = static_cast<double>(ir) / (n - 1);
+                double sg = static_cast<double>(ig) / (n - 1);
+                double sb = static_cast<double>(ib) / (n - 1);
+                Vec3 cam{sr * sr, sg * sg, sb * sb};
+                Vec3 rgb = multiply(total, cam);
+                for (int c = 0; c < 3; ++c) {
+                    double v = std::min(std::max(rgb[c], 0.0), 1.0);
+                    *out++ = static_cast<float>(encode(settings.output_space, v));
+                }
+            }
+        }
+    }
+
+    return lut;
+}
+
+std::shared_ptr<const ColorLut3D> ColorLut3D::cached(const CameraColor& camera, const ColorSettings& settings) {
+    LutKey key;
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            key.matrix[i * 3 + j] = camera.rgb_cam[i][j];
+    for (int c = 0; c < 3; ++c) {
+        key.cam_mul[c] = camera.cam_mul[c];
+        key.white_balance[c] = settings.white_balance[c];
+    }
+    key.space = static_cast<int>(settings.output_space);
+    key.exposure = settings.exposure;
+    key.temperature = settings.temperature;
+    key.tint = settings.tint;
+    key.size = settings.lut_size;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex());
+        auto it = lutCache().find(key);
+        if (it != lutCache().end()) {
+            return it->second;
+        }
+    }
+
+    // 在锁外构建，避免阻塞其他线程
+    auto lut = std::make_shared<const ColorLut3D>(build(camera, settings));
+
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    auto& cache = lutCache();
+    if (cache.size() >= kMaxCachedLuts) {
+        cache.clear();
+    }
+    return cache.emplace(key, lut).first->second;
+}
+
+void ColorLut3D::clearCache() {
+    std::lock_guard<std::mutex> lock(cacheMutex());
+    lutCache().clear();
+}
+
+void ColorLut3D::apply(const PlanarImage& src, PlanarImage& dst, const CancellationToken& token) const {
+    if (!isValid() || !src.isValid() || !dst.isValid() ||
+        src.width() != dst.width() || src.height() != dst.height()) {
+        return;
+    }
+
+    const int width = src.width();
+    const int height = src.height();
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        if (cancel.skip(y)) {
+            continue;
+        }
+        applyRow(src.row(0, y), src.row(1, y), src.row(2, y),
+                 dst.row(0, y), dst.row(1, y), dst.row(2, y), width);
+    }
+}
+
+void ColorLut3D::apply(const HalfPlanarImage& src, PlanarImage& dst, const CancellationToken& token) const {
+    if (!isValid() || !src.isValid() || !dst.isValid() ||
+        src.width() != dst.width() || src.height() != dst.height()) {
+        return;
+    }
+
+    const int width = src.width();
+    const int height = src.height();
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        // 每线程一行 float 暂存：半精度解码后直接插值，不展开整幅图像
+        std::vector<float> scratch(static_cast<size_t>(width) * 3);
+        float* r = scratch.data();
+        float* g = r + width;
+        float* b = g + width;
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            if (cancel.skip(y)) {
+                continue;
+            }
+            src.loadRow(0, y, r);
+            src.loadRow(1, y, g);
+            src.loadRow(2, y, b);
+            applyRow(r, g, b, dst.row(0, y), dst.row(1, y), dst.row(2, y), width);
+        }
+    }
+}
+
+namespace {
+
+inline float minFloat(float a, float b) { return b < a ? b : a; }
+inline float maxFloat(float a, float b) { return a < b ? b : a; }
+inline int minInt(int a, int b) { return b < a ? b : a; }
+inline float clamp01(float v) { return v > 0.0f ? minFloat(v, 1.0f) : 0.0f; }
+
+} // namespace
+
+void ColorLut3D::applyRow(const float* in_r, const float* in_g, const float* in_b,
+                          float* out_r, float* out_g, float* out_b, int width) const {
+    const int n = size_;
+    const float scale = static_cast<float>(n - 1);
+    const float* table = table_.data();
+    const int db = 3;
+    const int dg = n * 3;
+    const int dr = n * n * 3;
+
+    // 无分支的四面体插值，可向量化：小数部分排序后，权重是相邻两个之差；
+    // 四面体的另两个顶点沿最大分量方向走一步，以及从 c111 沿最小分量方向退一步
+#pragma omp simd
+    for (int x = 0; x < width; ++x) {
+        // sqrt 整形后定位网格（按值比较，std::min/max 返回引用，钳位不能编译为向量 min/max）
+        float sr = std::sqrt(clamp01(in_r[x])) * scale;
+        float sg = std::sqrt(clamp01(in_g[x])) * scale;
+        float sb = std::sqrt(clamp01(in_b[x])) * scale;
+        int ir = minInt(static_cast<int>(sr), n - 2);
+        int ig = minInt(static_cast<int>(sg), n - 2);
+        int ib = minInt(static_cast<int>(sb), n - 2);
+        float fr = sr - ir;
+        float fg = sg - ig;
+        float fb = sb - ib;
+
+        const float hi = maxFloat(maxFloat(fr, fg), fb);
+        const float lo = minFloat(minFloat(fr, fg), fb);
+        const float mid = maxFloat(minFloat(fr, fg), minFloat(maxFloat(fr, fg), fb));
+        const int step_hi = ((fr >= fg) & (fr >= fb)) ? dr : (fg >= fb ? dg : db);
+        const int step_lo = ((fr < fg) & (fr < fb)) ? dr : (fg < fb ? dg : db);
+
+        const int i000 = ir * dr + ig * dg + ib * db;
+        const int i111 = i000 + dr + dg + db;
+        const int ia = i000 + step_hi;
+        const int ib2 = i111 - step_lo;
+        const float w0 = 1.0f - hi;
+        const float w1 = hi - mid;
+        const float w2 = mid - lo;
+        const float w3 = lo;
+
+        out_r[x] = w0 * table[i000] + w1 * table[ia] + w2 * table[ib2] + w3 * table[i111];
+        out_g[x] = w0 * table[i000 + 1] + w1 * table[ia + 1] + w2 * table[ib2 + 1] + w3 * table[i111 + 1];
+        out_b[x] = w0 * table[i000 + 2] + w1 * table[ia + 2] + w2 * table[ib2 + 2] + w3 * table[i111 + 2];
+    }
+}
+
+} // namespace PixRaw
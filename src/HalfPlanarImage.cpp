@@ -0,0 +1,288 @@
+#include "HalfPlanarImage.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace PixRaw {
+
+namespace {
+
+constexpr int kPlaneAlignment = 64;  // 字节
+
+std::shared_ptr<uint16_t> allocatePlanes(size_t count) {
+    std::align_val_t align{kPlaneAlignment};
+    uint16_t* ptr = static_cast<uint16_t*>(::operator new[](count * sizeof(uint16_t), align));
+    return std::shared_ptr<uint16_t>(ptr, [align](uint16_t* p) { ::operator delete[](p, align); });
+}
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+// === 转换 ===
+
+uint16_t HalfPlanarImage::toHalf(float value) {
+    uint32_t f = floatBits(value);
+    uint32_t sign = (f >> 16) & 0x8000u;
+    f &= 0x7fffffffu;
+
+    // 溢出、无穷大和 NaN
+    if (f >= 0x47800000u) {
+        return static_cast<uint16_t>(sign | (f > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    }
+
+    // 非规格化数：借助浮点加法完成移位和舍入
+    if (f < 0x38800000u) {
+        uint32_t bits = floatBits(bitsFloat(f) + 0.5f) - 0x3f000000u;
+        return static_cast<uint16_t>(sign | bits);
+    }
+
+    // 规格化数：调整指数偏置，尾数按最近偶数舍入
+    uint32_t odd = (f >> 13) & 1u;
+    f += 0xc8000fffu + odd;
+    return static_cast<uint16_t>(sign | (f >> 13));
+}
+
+float HalfPlanarImage::toFloat(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+
+    if (exponent == 0) {
+        // 零或非规格化数：mantissa * 2^-24
+        float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+        return bitsFloat(sign | floatBits(magnitude));
+    }
+    if (exponent == 31) {
+        return bitsFloat(sign | 0x7f800000u | (mantissa << 13));
+    }
+    return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+void HalfPlanarImage::toHalf(const float* src, uint16_t* dst, int count) {
+    int i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), h);
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = toHalf(src[i]);
+    }
+}
+
+void HalfPlanarImage::toFloat(const uint16_t* src, float* dst, int count) {
+    int i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = toFloat(src[i]);
+    }
+}
+
+// === HalfPlanarImage 实现 ===
+
+HalfPlanarImage::HalfPlanarImage() = default;
+
+HalfPlanarImage::HalfPlanarImage(int width, int height)
+    : width_(width)
+    , height_(height)
+{
+    if (width <= 0 || height <= 0) {
+        width_ = 0;
+        height_ = 0;
+        return;
+    }
+
+    // 行跨度向上取整到对齐的元素数
+    constexpr int elements_per_line = kPlaneAlignment / static_cast<int>(sizeof(uint16_t));
+    stride_ = (width + elements_per_line - 1) / elements_per_line * elements_per_line;
+
+    size_t count = planeSize() * kChannels;
+    buffer_ = allocatePlanes(count);
+    data_ = buffer_.get();
+    std::memset(data_, 0, count * sizeof(uint16_t));
+}
+
+HalfPlanarImage::~HalfPlanarImage() = default;
+
+HalfPlanarImage::HalfPlanarImage(HalfPlanarImage&& other) noexcept
+    : width_(other.width_)
+    , height_(other.height_)
+    , stride_(other.stride_)
+    , buffer_(std::move(other.buffer_))
+    , data_(other.data_)
+{
+    other.width_ = 0;
+    other.height_ = 0;
+    other.stride_ = 0;
+    other.data_ = nullptr;
+}
+
+HalfPlanarImage& HalfPlanarImage::operator=(HalfPlanarImage&& other) noexcept {
+    if (this != &other) {
+        width_ = other.width_;
+        height_ = other.height_;
+        stride_ = other.stride_;
+        buffer_ = std::move(other.buffer_);
+        data_ = other.data_;
+
+        other.width_ = 0;
+        other.height_ = 0;
+        other.stride_ = 0;
+        other.data_ = nullptr;
+    }
+    return *this;
+}
+
+HalfPlanarImage HalfPlanarImage::fromPacked(const void* data, int width, int height, int bits) {
+    if (!data || (bits != 8 && bits != 16)) {
+        return HalfPlanarImage();
+    }
+
+    HalfPlanarImage result(width, height);
+    if (!result.isValid()) {
+        return result;
+    }
+
+#pragma omp parallel
+    {
+        // 每线程一行 float 暂存，再批量转换为半精度
+        std::unique_ptr<float[]> scratch(new float[static_cast<size_t>(width) * kChannels]);
+        float* r = scratch.get();
+        float* g = r + width;
+        float* b = g + width;
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            if (bits == 16) {
+                const uint16_t* src = static_cast<const uint16_t*>(data) + static_cast<size_t>(y) * width * 3;
+                const float scale = 1.0f / 65535.0f;
+                for (int x = 0; x < width; ++x) {
+                    r[x] = src[x * 3 + 0] * scale;
+                    g[x] = src[x * 3 + 1] * scale;
+                    b[x] = src[x * 3 + 2] * scale;
+                }
+            } else {
+                const uint8_t* src = static_cast<const uint8_t*>(data) + static_cast<size_t>(y) * width * 3;
+                const float scale = 1.0f / 255.0f;
+                for (int x = 0; x < width; ++x) {
+                    r[x] = src[x * 3 + 0] * scale;
+                    g[x] = src[x * 3 + 1] * scale;
+                    b[x] = src[x * 3 + 2] * scale;
+                }
+            }
+
+            toHalf(r, result.row(0, y), width);
+            toHalf(g, result.row(1, y), width);
+            toHalf(b, result.row(2, y), width);
+        }
+    }
+
+    return result;
+}
+
+HalfPlanarImage HalfPlanarImage::fromPlanar(const PlanarImage& image) {
+    if (!image.isValid()) {
+        return HalfPlanarImage();
+    }
+
+    HalfPlanarImage result(image.width(), image.height());
+    for (int c = 0; c < kChannels; ++c) {
+        for (int y = 0; y < image.height(); ++y) {
+            toHalf(image.row(c, y), result.row(c, y), image.width());
+        }
+    }
+    return result;
+}
+
+PlanarImage HalfPlanarImage::toPlanar() const {
+    if (!data_) {
+        return PlanarImage();
+    }
+
+    PlanarImage result(width_, height_);
+    for (int c = 0; c < kChannels; ++c) {
+        for (int y = 0; y < height_; ++y) {
+            loadRow(c, y, result.row(c, y));
+        }
+    }
+    return result;
+}
+
+void HalfPlanarImage::resampleInto(PlanarImage& dst, int x, int y, int width, int height,
+                                   const CancellationToken& token) const {
+    if (!data_ || !dst.isValid() || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > width_ || y + height > height_) {
+        return;
+    }
+
+    const int out_width = dst.width();
+    const int out_height = dst.height();
+
+    // 与 PlanarImage::resampleInto 相同的源区间；每个输出像素的累加顺序（先行后列）也相同
+    std::vector<int> columns(static_cast<size_t>(out_width) + 1);
+    for (int i = 0; i <= out_width; ++i) {
+        columns[i] = static_cast<int>(static_cast<int64_t>(i) * width / out_width);
+    }
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        std::vector<float> line(static_cast<size_t>(width));  // 解码后的源行（区域内）
+
+#pragma omp for schedule(static)
+        for (int oy = 0; oy < out_height; ++oy) {
+            if (cancel.skip(oy)) {
+                continue;
+            }
+
+            int y0 = y + static_cast<int>(static_cast<int64_t>(oy) * height / out_height);
+            int y1 = std::max(y + static_cast<int>(static_cast<int64_t>(oy + 1) * height / out_height), y0 + 1);
+
+            for (int c = 0; c < kChannels; ++c) {
+                float* out = dst.row(c, oy);
+                std::fill(out, out + out_width, 0.0f);
+                for (int sy = y0; sy < y1; ++sy) {
+                    toFloat(row(c, sy) + x, line.data(), width);
+                    for (int ox = 0; ox < out_width; ++ox) {
+                        int x0 = columns[ox];
+                        int x1 = std::max(columns[ox + 1], x0 + 1);
+                        float sum = out[ox];
+                        for (int sx = x0; sx < x1; ++sx) {
+                            sum += line[sx];
+                        }
+                        out[ox] = sum;
+                    }
+                }
+                for (int ox = 0; ox < out_width; ++ox) {
+                    int x0 = columns[ox];
+                    int x1 = std::max(columns[ox + 1], x0 + 1);
+                    out[ox] /= static_cast<float>((x1 - x0) * (y1 - y0));
+                }
+            }
+        }
+    }
+}
+
+} // namespace PixRaw
@@ -1,148 +1,314 @@
 #include "ImageAdjuster.h"
 #include <cmath>
+#include <cstring>
 #include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+// 融合内核依赖逐像素函数完全内联后才能向量化
+#if defined(_MSC_VER)
+#define PIX_RAW_ALWAYS_INLINE __forceinline
+#else
+#define PIX_RAW_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
 
 namespace PixRaw {
 
-RawImage ImageAdjuster::applyAdjustments(const RawImage& image, const RawAdjustments& adjustments) {
-    if (!image.isValid()) {
-        return RawImage();  // 返回空图像
-    }
+namespace {
 
-    if (!adjustments.hasAdjustments()) {
-        // 如果没有调整，需要创建一个副本（因为禁止拷贝）
-        RawImage result(image.width(), image.height(), image.format());
-        int dataSize = image.width() * image.height() * image.bytesPerPixel();
-        std::memcpy(result.data(), image.data(), dataSize);
-        return result;
+// 阶段位：按应用顺序排列
+enum StageBits : unsigned {
+    kExposure = 1u << 0,
+    kContrast = 1u << 1,
+    kSaturation = 1u << 2,
+    kTemperature = 1u << 3,
+    kTint = 1u << 4
+};
+
+constexpr unsigned kStageCombinations = 1u << 5;
+constexpr int kFormatCount = 3;
+
+/**
+ * 各阶段预先计算的常量
+ */
+struct StageParams {
+    float exposure = 1.0f;     // 曝光倍率 2^EV
+    float contrast = 1.0f;     // 对比度斜率（以 128/255 为中心）
+    float saturation = 1.0f;   // 饱和度倍率
+    float r_scale = 1.0f;      // 色温：R/B 平面为仿射变换 v' = v * scale + offset
+    float r_offset = 0.0f;
+    float b_scale = 1.0f;
+    float b_offset = 0.0f;
+    float tint = 1.0f;         // 色调：绿色倍率
+};
+
+unsigned stageMask(const RawAdjustments& adjustments) {
+    unsigned mask = 0;
+    if (adjustments.exposure != 0.0f) mask |= kExposure;
+    if (adjustments.contrast != 0.0f) mask |= kContrast;
+    if (adjustments.saturation != 0.0f) mask |= kSaturation;
+    if (adjustments.temperature != 0.0f) mask |= kTemperature;
+    if (adjustments.tint != 0.0f) mask |= kTint;
+    return mask;
+}
+
+StageParams stageParams(const RawAdjustments& adjustments) {
+    StageParams p;
+
+    // 曝光：对数刻度，0 表示不变
+    p.exposure = std::pow(2.0f, adjustments.exposure);
+
+    // 对比度：-50 ~ 50，0 表示不变
+    const float contrast = adjustments.contrast;
+    p.contrast = (259.0f * (contrast + 255.0f)) / (255.0f * (259.0f - contrast));
+
+    // 饱和度：-100 ~ 100，0 表示不变
+    p.saturation = 1.0f + (adjustments.saturation / 100.0f);
+
+    // 色温：正值偏暖（增加红色、减少蓝色），负值偏冷
+    const float factor = adjustments.temperature / 100.0f;
+    if (adjustments.temperature > 0) {
+        p.r_scale = 1.0f - factor * 0.5f;
+        p.r_offset = factor * 0.5f;
+        p.b_scale = 1.0f - factor * 0.3f;
+        p.b_offset = 0.0f;
+    } else {
+        p.r_scale = 1.0f + factor * 0.3f;
+        p.r_offset = 0.0f;
+        p.b_scale = 1.0f + factor * 0.5f;
+        p.b_offset = -factor * 0.5f;
     }
 
-    // 创建图像副本
-    RawImage result(image.width(), image.height(), image.format());
-    int dataSize = image.width() * image.height() * image.bytesPerPixel();
-    std::memcpy(result.data(), image.data(), dataSize);
+    // 色调（显示空间近似，PixRaw 解码流程中由色彩管理在相机空间处理）
+    // 正值偏品红（减少绿色），负值偏绿
+    p.tint = std::pow(2.0f, -adjustments.tint / 200.0f);
+    return p;
+}
 
-    uint8_t* data = result.data();
-    int width = result.width();
-    int height = result.height();
+// 按值比较；配合 CMakeLists.txt 中本文件的浮点选项编译为向量 min/max 指令
+PIX_RAW_ALWAYS_INLINE float clamp01(float value) {
+    float v = value > 0.0f ? value : 0.0f;
+    return v < 1.0f ? v : 1.0f;
+}
 
-    // 按顺序应用调整
-    // 1. 曝光
-    if (adjustments.exposure != 0.0f) {
-        applyExposure(data, width, height, adjustments.exposure);
+// 单个像素依次经过启用的阶段；Stages 为编译期常量，未启用的阶段不生成代码
+template <unsigned Stages>
+PIX_RAW_ALWAYS_INLINE void adjustPixel(const StageParams& p, float& r, float& g, float& b) {
+    if constexpr ((Stages & kExposure) != 0) {
+        r = clamp01(r * p.exposure);
+        g = clamp01(g * p.exposure);
+        b = clamp01(b * p.exposure);
+    }
+    if constexpr ((Stages & kContrast) != 0) {
+        const float mid = 128.0f / 255.0f;
+        r = clamp01(p.contrast * (r - mid) + mid);
+        g = clamp01(p.contrast * (g - mid) + mid);
+        b = clamp01(p.contrast * (b - mid) + mid);
+    }
+    if constexpr ((Stages & kSaturation) != 0) {
+        // 按亮度混合
+        const float gray = 0.299f * r + 0.587f * g + 0.114f * b;
+        r = clamp01(gray + (r - gray) * p.saturation);
+        g = clamp01(gray + (g - gray) * p.saturation);
+        b = clamp01(gray + (b - gray) * p.saturation);
     }
+    if constexpr ((Stages & kTemperature) != 0) {
+        r = clamp01(r * p.r_scale + p.r_offset);
+        b = clamp01(b * p.b_scale + p.b_offset);
+    }
+    if constexpr ((Stages & kTint) != 0) {
+        g = clamp01(g * p.tint);
+    }
+}
+
+// === 像素格式读写（与 PlanarImage 的 fromInterleaved/toInterleaved 量化一致） ===
 
-    // 2. 对比度
-    if (adjustments.contrast != 0.0f) {
-        applyContrast(data, width, height, adjustments.contrast);
+PIX_RAW_ALWAYS_INLINE uint8_t quantize8(float value) {
+    return static_cast<uint8_t>(clamp01(value) * 255.0f + 0.5f);
+}
+
+template <PixelFormat Format>
+struct PixelCodec;
+
+template <>
+struct PixelCodec<PixelFormat::RGB888> {
+    PIX_RAW_ALWAYS_INLINE static void load(const uint8_t* px, float& r, float& g, float& b) {
+        const float scale = 1.0f / 255.0f;
+        r = px[0] * scale;
+        g = px[1] * scale;
+        b = px[2] * scale;
+    }
+    PIX_RAW_ALWAYS_INLINE static void store(const uint8_t*, uint8_t* out, float r, float g, float b) {
+        out[0] = quantize8(r);
+        out[1] = quantize8(g);
+        out[2] = quantize8(b);
     }
+    static constexpr int kBytes = 3;
+};
 
-    // 3. 饱和度
-    if (adjustments.saturation != 0.0f) {
-        applySaturation(data, width, height, adjustments.saturation);
+template <>
+struct PixelCodec<PixelFormat::RGBA8888> {
+    PIX_RAW_ALWAYS_INLINE static void load(const uint8_t* px, float& r, float& g, float& b) {
+        PixelCodec<PixelFormat::RGB888>::load(px, r, g, b);
     }
+    PIX_RAW_ALWAYS_INLINE static void store(const uint8_t* px, uint8_t* out, float r, float g, float b) {
+        PixelCodec<PixelFormat::RGB888>::store(px, out, r, g, b);
+        out[3] = px[3];  // 保留 alpha
+    }
+    static constexpr int kBytes = 4;
+};
 
-    // 4. 色温
-    if (adjustments.temperature != 0.0f) {
-        applyTemperature(data, width, height, adjustments.temperature);
+template <>
+struct PixelCodec<PixelFormat::RGB565> {
+    PIX_RAW_ALWAYS_INLINE static void load(const uint8_t* px, float& r, float& g, float& b) {
+        uint16_t p = static_cast<uint16_t>(px[0] | (px[1] << 8));
+        r = ((p >> 11) & 0x1F) / 31.0f;
+        g = ((p >> 5) & 0x3F) / 63.0f;
+        b = (p & 0x1F) / 31.0f;
+    }
+    PIX_RAW_ALWAYS_INLINE static void store(const uint8_t*, uint8_t* out, float r, float g, float b) {
+        uint16_t p = static_cast<uint16_t>((static_cast<int>(clamp01(r) * 31.0f + 0.5f) << 11) |
+                                           (static_cast<int>(clamp01(g) * 63.0f + 0.5f) << 5) |
+                                           static_cast<int>(clamp01(b) * 31.0f + 0.5f));
+        out[0] = static_cast<uint8_t>(p & 0xFF);
+        out[1] = static_cast<uint8_t>(p >> 8);
     }
+    static constexpr int kBytes = 2;
+};
 
-    return result;
-}
+// === 融合内核 ===
+
+using PlanarKernel = void (*)(PlanarImage&, const StageParams&, RowBandCancellation&);
+using PackedKernel = void (*)(const RawImage&, RawImage&, const StageParams&);
+
+template <unsigned Stages>
+void planarKernel(PlanarImage& image, const StageParams& params, RowBandCancellation& cancel) {
+    const StageParams p = params;  // 局部副本：写像素不会与参数别名，常量可留在寄存器
+    const int width = image.width();
+    const int height = image.height();
+
+#pragma omp parallel for schedule(static)
+    for (int y = 0; y < height; ++y) {
+        if (cancel.skip(y)) {
+            continue;
+        }
 
-void ImageAdjuster::applyExposure(uint8_t* data, int width, int height, float exposure) {
-    // 曝光调整：使用对数刻度
-    // exposure = 0.0 表示不变
-    // exposure > 0.0 增加亮度
-    // exposure < 0.0 减少亮度
-    float factor = std::pow(2.0f, exposure);
+        float* r = image.row(0, y);
+        float* g = image.row(1, y);
+        float* b = image.row(2, y);
 
-    int pixelCount = width * height * 3;  // RGB888
-    for (int i = 0; i < pixelCount; ++i) {
-        float value = data[i] * factor;
-        data[i] = toUint8(value);
+#pragma omp simd
+        for (int x = 0; x < width; ++x) {
+            float vr = r[x];
+            float vg = g[x];
+            float vb = b[x];
+            adjustPixel<Stages>(p, vr, vg, vb);
+            r[x] = vr;
+            g[x] = vg;
+            b[x] = vb;
+        }
     }
 }
 
-void ImageAdjuster::applyContrast(uint8_t* data, int width, int height, float contrast) {
-    // 对比度调整
-    // contrast = 0 表示不变
-    // range: -50 to 50
-    float factor = (259.0f * (contrast + 255.0f)) / (255.0f * (259.0f - contrast));
+// 交错像素按行拆成三个 float 行、计算、再打包：三段循环各自都能向量化，
+// 比逐像素读写交错字节的单个循环快
+template <PixelFormat Format, unsigned Stages>
+void packedKernel(const RawImage& src, RawImage& dst, const StageParams& params) {
+    const StageParams p = params;
+    using Codec = PixelCodec<Format>;
+    const int width = src.width();
+    const int height = src.height();
+
+#pragma omp parallel
+    {
+        std::vector<float> scratch(static_cast<size_t>(width) * 3);
+        float* r = scratch.data();
+        float* g = r + width;
+        float* b = g + width;
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* in = src.row(y);
+            uint8_t* out = dst.row(y);
 
-    int pixelCount = width * height * 3;
-    for (int i = 0; i < pixelCount; ++i) {
-        float value = factor * (data[i] - 128.0f) + 128.0f;
-        data[i] = toUint8(value);
+#pragma omp simd
+            for (int x = 0; x < width; ++x) {
+                Codec::load(in + x * Codec::kBytes, r[x], g[x], b[x]);
+            }
+
+#pragma omp simd
+            for (int x = 0; x < width; ++x) {
+                adjustPixel<Stages>(p, r[x], g[x], b[x]);
+            }
+
+#pragma omp simd
+            for (int x = 0; x < width; ++x) {
+                Codec::store(in + x * Codec::kBytes, out + x * Codec::kBytes, r[x], g[x], b[x]);
+            }
+        }
     }
 }
 
-void ImageAdjuster::applySaturation(uint8_t* data, int width, int height, float saturation) {
-    // 饱和度调整
-    // saturation = 0 表示不变
-    // range: -100 to 100
-    float saturationFactor = 1.0f + (saturation / 100.0f);
+// === 分派表：按阶段组合（和像素格式）索引，所有组合在编译期实例化 ===
+
+template <unsigned... Masks>
+constexpr std::array<PlanarKernel, sizeof...(Masks)> makePlanarTable(std::integer_sequence<unsigned, Masks...>) {
+    return {{&planarKernel<Masks>...}};
+}
+
+template <PixelFormat Format, unsigned... Masks>
+constexpr std::array<PackedKernel, sizeof...(Masks)> makePackedTable(std::integer_sequence<unsigned, Masks...>) {
+    return {{&packedKernel<Format, Masks>...}};
+}
+
+using StageSequence = std::make_integer_sequence<unsigned, kStageCombinations>;
 
-    int pixelCount = width * height;
-    for (int i = 0; i < pixelCount; ++i) {
-        float r = data[i * 3];
-        float g = data[i * 3 + 1];
-        float b = data[i * 3 + 2];
+constexpr std::array<PlanarKernel, kStageCombinations> kPlanarKernels = makePlanarTable(StageSequence());
 
-        // 转换到 HSL，调整饱和度
-        float max = std::max({r, g, b});
-        float min = std::min({r, g, b});
-        float gray = 0.299f * r + 0.587f * g + 0.114f * b;
+// 按 PixelFormat 的枚举值排列
+constexpr std::array<std::array<PackedKernel, kStageCombinations>, kFormatCount> kPackedKernels = {{
+    makePackedTable<PixelFormat::RGB888>(StageSequence()),
+    makePackedTable<PixelFormat::RGBA8888>(StageSequence()),
+    makePackedTable<PixelFormat::RGB565>(StageSequence()),
+}};
 
-        // 应用饱和度
-        r = gray + (r - gray) * saturationFactor;
-        g = gray + (g - gray) * saturationFactor;
-        b = gray + (b - gray) * saturationFactor;
+} // namespace
 
-        data[i * 3] = toUint8(r);
-        data[i * 3 + 1] = toUint8(g);
-        data[i * 3 + 2] = toUint8(b);
+RawImage ImageAdjuster::applyAdjustments(const RawImage& image, const RawAdjustments& adjustments) {
+    if (!image.isValid()) {
+        return RawImage();  // 返回空图像
     }
-}
 
-void ImageAdjuster::applyTemperature(uint8_t* data, int width, int height, float temperature) {
-    // 色温调整
-    // temperature = 0 表示不变
-    // temperature < 0 偏冷（增加蓝色）
-    // temperature > 0 偏暖（增加黄色/红色）
-    float factor = temperature / 100.0f;
-
-    int pixelCount = width * height;
-    for (int i = 0; i < pixelCount; ++i) {
-        float r = data[i * 3];
-        float g = data[i * 3 + 1];
-        float b = data[i * 3 + 2];
-
-        // 应用色温偏移
-        if (temperature > 0) {
-            // 暖色调：增加红色，减少蓝色
-            r = r + (255.0f - r) * factor * 0.5f;
-            b = b * (1.0f - factor * 0.3f);
-        } else {
-            // 冷色调：减少红色，增加蓝色
-            r = r * (1.0f + factor * 0.3f);
-            b = b + (255.0f - b) * (-factor) * 0.5f;
-        }
+    const unsigned mask = stageMask(adjustments);
+    const int format = static_cast<int>(image.format());
+    if (mask == 0 || format < 0 || format >= kFormatCount) {
+        // 如果没有调整，需要创建一个副本（因为禁止拷贝）
+        return image.clone();
+    }
 
-        data[i * 3] = toUint8(r);
-        data[i * 3 + 1] = toUint8(g);
-        data[i * 3 + 2] = toUint8(b);
+    RawImage result(image.width(), image.height(), image.format());
+    if (!result.isValid()) {
+        return RawImage();
     }
-}
 
-float ImageAdjuster::clamp(float value, float min, float max) {
-    if (value < min) return min;
-    if (value > max) return max;
-    return value;
+    kPackedKernels[format][mask](image, result, stageParams(adjustments));
+    return result;
 }
 
-uint8_t ImageAdjuster::toUint8(float value) {
-    return static_cast<uint8_t>(clamp(value, 0.0f, 255.0f));
+void ImageAdjuster::applyAdjustments(PlanarImage& image, const RawAdjustments& adjustments,
+                                     const CancellationToken& token) {
+    if (!image.isValid()) {
+        return;
+    }
+
+    const unsigned mask = stageMask(adjustments);
+    if (mask == 0) {
+        return;
+    }
+
+    RowBandCancellation cancel(token);
+    kPlanarKernels[mask](image, stageParams(adjustments), cancel);
 }
 
 } // namespace PixRaw
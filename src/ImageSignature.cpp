@@ -0,0 +1,325 @@
+#include "ImageSignature.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace PixRaw {
+
+namespace {
+
+constexpr int kHashGrid = 32;   // 感知哈希的亮度网格
+constexpr int kHashBits = 8;    // 取 8x8 低频 DCT 系数
+constexpr int kColorGrid = ImageSignature::kColorGrid;
+constexpr double kPi = 3.14159265358979323846;
+
+/**
+ * 每线程的累加结果
+ */
+struct SignatureAccumulator {
+    double luma[kHashGrid][kHashGrid] = {};                  // 哈希网格亮度和
+    double color[kColorGrid][kColorGrid][3] = {};            // 颜色网格 RGB 和
+    double lap_sum[kColorGrid][kColorGrid] = {};             // 拉普拉斯响应和 / 平方和 / 个数
+    double lap_sq[kColorGrid][kColorGrid] = {};
+    uint64_t lap_count[kColorGrid][kColorGrid] = {};
+
+    void merge(const SignatureAccumulator& other) {
+        for (int i = 0; i < kHashGrid; ++i) {
+            for (int j = 0; j < kHashGrid; ++j) {
+                luma[i][j] += other.luma[i][j];
+            }
+        }
+        for (int i = 0; i < kColorGrid; ++i) {
+            for (int j = 0; j < kColorGrid; ++j) {
+                for (int c = 0; c < 3; ++c) {
+                    color[i][j][c] += other.color[i][j][c];
+                }
+                lap_sum[i][j] += other.lap_sum[i][j];
+                lap_sq[i][j] += other.lap_sq[i][j];
+                lap_count[i][j] += other.lap_count[i][j];
+            }
+        }
+    }
+};
+
+// 把 [0, extent) 均分为 cells 段，返回各段起点（cells + 1 个）
+std::vector<int> segmentBounds(int extent, int cells) {
+    std::vector<int> bounds(cells + 1);
+    for (int i = 0; i <= cells; ++i) {
+        bounds[i] = static_cast<int>(static_cast<int64_t>(i) * extent / cells);
+    }
+    return bounds;
+}
+
+// 32x32 亮度网格 -> 8x8 低频 DCT-II 系数 -> 与中值比较得到 64 位哈希
+uint64_t dctHash(const double grid[kHashGrid][kHashGrid]) {
+    double basis[kHashBits][kHashGrid];
+    for (int u = 0; u < kHashBits; ++u) {
+        for (int x = 0; x < kHashGrid; ++x) {
+            basis[u][x] = std::cos(kPi * (2 * x + 1) * u / (2.0 * kHashGrid));
+        }
+    }
+
+    // 可分离：先按行变换，再按列变换，只计算需要的低频部分
+    double rows[kHashGrid][kHashBits];
+    for (int y = 0; y < kHashGrid; ++y) {
+        for (int u = 0; u < kHashBits; ++u) {
+            double s = 0.0;
+            for (int x = 0; x < kHashGrid; ++x) {
+                s += grid[y][x] * basis[u][x];
+            }
+            rows[y][u] = s;
+        }
+    }
+
+    double coeffs[kHashBits * kHashBits];
+    for (int v = 0; v < kHashBits; ++v) {
+        for (int u = 0; u < kHashBits; ++u) {
+            double s = 0.0;
+            for (int y = 0; y < kHashGrid; ++y) {
+                s += rows[y][u] * basis[v][y];
+            }
+            coeffs[v * kHashBits + u] = s;
+        }
+    }
+
+    double sorted[kHashBits * kHashBits];
+    std::copy(coeffs, coeffs + kHashBits * kHashBits, sorted);
+    std::nth_element(sorted, sorted + kHashBits * kHashBits / 2, sorted + kHashBits * kHashBits);
+    const double median = sorted[kHashBits * kHashBits / 2];
+
+    uint64_t hash = 0;
+    for (int i = 0; i < kHashBits * kHashBits; ++i) {
+        if (coeffs[i] > median) {
+            hash |= uint64_t(1) << i;
+        }
+    }
+    return hash;
+}
+
+} // namespace
+
+int ImageSignature::hashDistance(uint64_t a, uint64_t b) {
+    uint64_t v = a ^ b;
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+}
+
+float ImageSignature::colorDistance(const ImageSignature& other) const {
+    double sum = 0.0;
+    for (int i = 0; i < kColorBytes; ++i) {
+        double d = (static_cast<int>(color[i]) - static_cast<int>(other.color[i])) / 255.0;
+        sum += d * d;
+    }
+    return static_cast<float>(std::sqrt(sum / kColorBytes));
+}
+
+ImageSignature ImageSignature::compute(int width, int height, const RowSource& rows, bool linear,
+                                       SignatureSource source, const CancellationToken& token) {
+    ImageSignature result;
+    if (width < kHashGrid || height < kHashGrid || !rows) {
+        return result;
+    }
+
+    const std::vector<int> hash_x = segmentBounds(width, kHashGrid);
+    const std::vector<int> color_x = segmentBounds(width, kColorGrid);
+
+    SignatureAccumulator total;
+    RowBandCancellation cancel(token);
+    const int band_rows = RowBandCancellation::kRowBand;
+    const int bands = (height + band_rows - 1) / band_rows;
+
+#pragma omp parallel
+    {
+        SignatureAccumulator local;
+        std::vector<float> buffer(static_cast<size_t>(width) * 7);
+        float* r = buffer.data();
+        float* g = r + width;
+        float* b = g + width;
+        float* ring[3] = {b + width, b + 2 * width, b + 3 * width};  // 亮度滚动窗口，按 y % 3 索引
+
+        // 读取第 y 行并计算亮度；accumulate 为 true 时累加到哈希和颜色网格（行带外的邻行只参与拉普拉斯）
+        auto load = [&](int y, bool accumulate) {
+            rows(y, r, g, b);
+            float* l = ring[y % 3];
+            if (linear) {
+#pragma omp simd
+                for (int x = 0; x < width; ++x) {
+                    r[x] = std::sqrt(std::max(r[x], 0.0f));
+                    g[x] = std::sqrt(std::max(g[x], 0.0f));
+                    b[x] = std::sqrt(std::max(b[x], 0.0f));
+                }
+            }
+#pragma omp simd
+            for (int x = 0; x < width; ++x) {
+                l[x] = 255.0f * (0.2126f * r[x] + 0.7152f * g[x] + 0.0722f * b[x]);
+            }
+            if (!accumulate) {
+                return;
+            }
+
+            const int hy = static_cast<int>(static_cast<int64_t>(y) * kHashGrid / height);
+            for (int cell = 0; cell < kHashGrid; ++cell) {
+                float s = 0.0f;
+#pragma omp simd reduction(+ : s)
+                for (int x = hash_x[cell]; x < hash_x[cell + 1]; ++x) {
+                    s += l[x];
+                }
+                local.luma[hy][cell] += s;
+            }
+
+            const int cy = static_cast<int>(static_cast<int64_t>(y) * kColorGrid / height);
+            for (int cell = 0; cell < kColorGrid; ++cell) {
+                float sr = 0.0f;
+                float sg = 0.0f;
+                float sb = 0.0f;
+#pragma omp simd reduction(+ : sr, sg, sb)
+                for (int x = color_x[cell]; x < color_x[cell + 1]; ++x) {
+                    sr += r[x];
+                    sg += g[x];
+                    sb += b[x];
+                }
+                local.color[cy][cell][0] += sr;
+                local.color[cy][cell][1] += sg;
+                local.color[cy][cell][2] += sb;
+            }
+        };
+
+        // 第 y 行的 4 邻域拉普拉斯（需要 y-1、y+1 已在窗口中）
+        auto laplacian = [&](int y) {
+            const float* up = ring[(y + 2) % 3];
+            const float* mid = ring[y % 3];
+            const float* down = ring[(y + 1) % 3];
+            const int cy = static_cast<int>(static_cast<int64_t>(y) * kColorGrid / height);
+            for (int cell = 0; cell < kColorGrid; ++cell) {
+                const int x0 = std::max(color_x[cell], 1);
+                const int x1 = std::min(color_x[cell + 1], width - 1);
+                float s = 0.0f;
+                float s2 = 0.0f;
+#pragma omp simd reduction(+ : s, s2)
+                for (int x = x0; x < x1; ++x) {
+                    float v = up[x] + down[x] + mid[x - 1] + mid[x + 1] - 4.0f * mid[x];
+                    s += v;
+                    s2 += v * v;
+                }
+                if (x1 > x0) {
+                    local.lap_sum[cy][cell] += s;
+                    local.lap_sq[cy][cell] += s2;
+                    local.lap_count[cy][cell] += static_cast<uint64_t>(x1 - x0);
+                }
+            }
+        };
+
+#pragma omp for schedule(dynamic)
+        for (int band = 0; band < bands; ++band) {
+            const int y0 = band * band_rows;
+            const int y1 = std::min(height, y0 + band_rows);
+            if (cancel.skip(y0)) {
+                continue;
+            }
+
+            if (y0 > 0) {
+                load(y0 - 1, false);
+            }
+            load(y0, true);
+            for (int y = y0; y < y1; ++y) {
+                if (y + 1 < height) {
+                    load(y + 1, y + 1 < y1);
+                    if (y > 0) {
+                        laplacian(y);
+                    }
+                }
+            }
+        }
+
+#pragma omp critical(pixraw_signature_merge)
+        total.merge(local);
+    }
+
+    if (cancel.stopped()) {
+        return result;
+    }
+
+    // 网格均值：行 y 属于网格行 y * cells / height
+    std::vector<int> hash_rows(kHashGrid, 0);
+    std::vector<int> color_rows(kColorGrid, 0);
+    for (int y = 0; y < height; ++y) {
+        ++hash_rows[static_cast<int64_t>(y) * kHashGrid / height];
+        ++color_rows[static_cast<int64_t>(y) * kColorGrid / height];
+    }
+
+    double hash_grid[kHashGrid][kHashGrid];
+    for (int i = 0; i < kHashGrid; ++i) {
+        for (int j = 0; j < kHashGrid; ++j) {
+            double n = static_cast<double>(hash_rows[i]) * (hash_x[j + 1] - hash_x[j]);
+            hash_grid[i][j] = n > 0.0 ? total.luma[i][j] / n : 0.0;
+        }
+    }
+    result.perceptual_hash = dctHash(hash_grid);
+
+    double lap_sum = 0.0;
+    double lap_sq = 0.0;
+    uint64_t lap_count = 0;
+    double peak = 0.0;
+    for (int i = 0; i < kColorGrid; ++i) {
+        for (int j = 0; j < kColorGrid; ++j) {
+            double n = static_cast<double>(color_rows[i]) * (color_x[j + 1] - color_x[j]);
+            for (int c = 0; c < 3; ++c) {
+                double mean = n > 0.0 ? total.color[i][j][c] / n : 0.0;
+                mean = std::min(std::max(mean, 0.0), 1.0);
+                result.color[(i * kColorGrid + j) * 3 + c] = static_cast<uint8_t>(mean * 255.0 + 0.5);
+            }
+
+            const uint64_t count = total.lap_count[i][j];
+            if (count > 0) {
+                double m = total.lap_sum[i][j] / count;
+                peak = std::max(peak, total.lap_sq[i][j] / count - m * m);
+            }
+            lap_sum += total.lap_sum[i][j];
+            lap_sq += total.lap_sq[i][j];
+            lap_count += count;
+        }
+    }
+    if (lap_count > 0) {
+        double m = lap_sum / lap_count;
+        result.sharpness = static_cast<float>(std::max(lap_sq / lap_count - m * m, 0.0));
+    }
+    result.sharpness_peak = static_cast<float>(std::max(peak, 0.0));
+
+    result.analysis_width = width;
+    result.analysis_height = height;
+    result.source = source;
+    return result;
+}
+
+ImageSignature ImageSignature::fromImage(const RawImage& image, const CancellationToken& token) {
+    if (!image.isValid()) {
+        return ImageSignature();
+    }
+
+    const PixelFormat format = image.format();
+    const int width = image.width();
+    auto rows = [&image, format, width](int y, float* r, float* g, float* b) {
+        const uint8_t* src = image.row(y);
+        const float scale = 1.0f / 255.0f;
+        if (format == PixelFormat::RGB565) {
+            for (int x = 0; x < width; ++x) {
+                uint16_t p = static_cast<uint16_t>(src[2 * x] | (src[2 * x + 1] << 8));
+                r[x] = ((p >> 11) & 0x1F) / 31.0f;
+                g[x] = ((p >> 5) & 0x3F) / 63.0f;
+                b[x] = (p & 0x1F) / 31.0f;
+            }
+            return;
+        }
+        const int bpp = format == PixelFormat::RGBA8888 ? 4 : 3;
+        for (int x = 0; x < width; ++x) {
+            r[x] = src[x * bpp] * scale;
+            g[x] = src[x * bpp + 1] * scale;
+            b[x] = src[x * bpp + 2] * scale;
+        }
+    };
+    return compute(width, image.height(), rows, false, SignatureSource::Image, token);
+}
+
+} // namespace PixRaw
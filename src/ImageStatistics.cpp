@@ -0,0 +1,65 @@
+#include "ImageStatistics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace PixRaw {
+
+float ImageStatistics::percentile(int channel, double p) const {
+    if (channel < 0 || channel >= kChannels || count[channel] == 0 || bins <= 1) {
+        return 0.0f;
+    }
+
+    p = std::min(std::max(p, 0.0), 1.0);
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count[channel])));
+    uint64_t seen = 0;
+    const std::vector<uint64_t>& h = histogram[channel];
+    for (int i = 0; i < bins; ++i) {
+        seen += h[i];
+        if (seen >= target) {
+            return static_cast<float>(i) / (bins - 1);
+        }
+    }
+    return 1.0f;
+}
+
+// === StatisticsAccumulator 实现 ===
+
+StatisticsAccumulator::StatisticsAccumulator(const StatisticsOptions& options)
+    : bins_(options.bins > 256 ? 65536 : 256)
+    , scale_(static_cast<float>(bins_ - 1))
+{
+    highlight_bin_ = options.highlight_threshold > 1.0f ? bins_ : bin(options.highlight_threshold);
+    shadow_bin_ = options.shadow_threshold < 0.0f ? -1 : bin(options.shadow_threshold);
+    for (auto& h : histogram_) {
+        h.assign(bins_, 0);
+    }
+}
+
+void StatisticsAccumulator::merge(const StatisticsAccumulator& other) {
+    pixels_ += other.pixels_;
+    for (int c = 0; c < ImageStatistics::kChannels; ++c) {
+        uint64_t* dst = histogram_[c].data();
+        const uint64_t* src = other.histogram_[c].data();
+        for (int i = 0; i < bins_; ++i) {
+            dst[i] += src[i];
+        }
+        count_[c] += other.count_[c];
+        sum_[c] += other.sum_[c];
+        highlight_[c] += other.highlight_[c];
+        shadow_[c] += other.shadow_[c];
+    }
+}
+
+void StatisticsAccumulator::finish(ImageStatistics& out) const {
+    out.bins = bins_;
+    out.pixel_count = pixels_;
+    for (int c = 0; c < ImageStatistics::kChannels; ++c) {
+        out.histogram[c] = histogram_[c];
+        out.count[c] = count_[c];
+        out.highlight_clipped[c] = highlight_[c];
+        out.shadow_clipped[c] = shadow_[c];
+        out.mean[c] = count_[c] > 0 ? static_cast<double>(sum_[c]) / (static_cast<double>(count_[c]) * (bins_ - 1)) : 0.0;
+    }
+}
+
+} // namespace PixRaw
@@ -0,0 +1,413 @@
+#include "Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#endif
+
+namespace PixRaw {
+
+const char* stageName(DecodeStage stage) {
+    switch (stage) {
+        case DecodeStage::Open:      return "open";
+        case DecodeStage::Unpack:    return "unpack";
+        case DecodeStage::Process:   return "dcraw_process";
+        case DecodeStage::MakeImage: return "make_mem_image";
+        case DecodeStage::Convert:   return "convert";
+        case DecodeStage::Color:     return "color";
+        case DecodeStage::Adjust:    return "adjust";
+        case DecodeStage::Output:    return "output";
+        case DecodeStage::Thumbnail: return "thumbnail";
+        case DecodeStage::Signature: return "signature";
+        case DecodeStage::Count:     break;
+    }
+    return "unknown";
+}
+
+namespace {
+
+// 对数分桶直方图：桶 i 覆盖 [kMinMs * 2^((i-1)/4), kMinMs * 2^(i/4))
+class Histogram {
+public:
+    static constexpr int kBuckets = 128;
+    static constexpr double kMinMs = 0.001;
+
+    void add(double ms) {
+        int index = 0;
+        if (ms > kMinMs) {
+            index = std::min(kBuckets - 1, 1 + static_cast<int>(std::floor(4.0 * std::log2(ms / kMinMs))));
+        }
+        ++buckets_[index];
+        if (count_ == 0 || ms < min_) min_ = ms;
+        if (count_ == 0 || ms > max_) max_ = ms;
+        ++count_;
+        sum_ += ms;
+    }
+
+    HistogramSnapshot snapshot() const {
+        HistogramSnapshot s;
+        s.count = count_;
+        s.sum_ms = sum_;
+        s.min_ms = min_;
+        s.max_ms = max_;
+        s.p50_ms = percentile(0.50);
+        s.p90_ms = percentile(0.90);
+        s.p99_ms = percentile(0.99);
+        return s;
+    }
+
+private:
+    double percentile(double p) const {
+        if (count_ == 0) return 0.0;
+        uint64_t target = static_cast<uint64_t>(std::ceil(p * count_));
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            seen += buckets_[i];
+            if (seen >= target) {
+                double upper = kMinMs * std::pow(2.0, i / 4.0);
+                return std::min(std::max(upper, min_), max_);
+            }
+        }
+        return max_;
+    }
+
+    uint64_t buckets_[kBuckets] = {};
+    uint64_t count_ = 0;
+    double sum_ = 0.0;
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::map<std::pair<std::string, std::string>, Histogram> histograms;
+
+    bool chrome_trace = false;
+    std::string trace_path;
+    std::vector<TraceSpan> spans;
+    std::function<void(const TraceSpan&)> callback;
+    bool has_consumer = false;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point kEpoch = std::chrono::steady_clock::now();
+
+std::string escapeJson(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) continue;
+        out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+// === Instrumentation 实现 ===
+
+void Instrumentation::record(const DecodeStats& stats) {
+    if (!stats.isValid()) {
+        return;
+    }
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.histograms[{stats.operation, "total"}].add(stats.wall_ms);
+    for (int i = 0; i < kStageCount; ++i) {
+        if (stats.stages[i].calls > 0) {
+            r.histograms[{stats.operation, stageName(static_cast<DecodeStage>(i))}].add(stats.stages[i].wall_ms);
+        }
+    }
+}
+
+std::vector<HistogramSnapshot> Instrumentation::histograms() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    std::vector<HistogramSnapshot> result;
+    result.reserve(r.histograms.size());
+    for (const auto& entry : r.histograms) {
+        HistogramSnapshot s = entry.second.snapshot();
+        s.operation = entry.first.first;
+        s.stage = entry.first.second;
+        result.push_back(s);
+    }
+    return result;
+}
+
+void Instrumentation::resetHistograms() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.histograms.clear();
+}
+
+bool Instrumentation::startChromeTrace(const std::string& path) {
+    if (path.empty()) {
+        return false;
+    }
+
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.chrome_trace = true;
+    r.trace_path = path;
+    r.spans.clear();
+    r.has_consumer = true;
+    return true;
+}
+
+bool Instrumentation::stopChromeTrace() {
+    std::vector<TraceSpan> spans;
+    std::string path;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.chrome_trace) {
+            return false;
+        }
+        spans.swap(r.spans);
+        path.swap(r.trace_path);
+        r.chrome_trace = false;
+        r.has_consumer = static_cast<bool>(r.callback);
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    out << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const TraceSpan& s = spans[i];
+        out << "{\"name\":\"" << escapeJson(s.name) << "\",\"cat\":\"" << escapeJson(s.category)
+            << "\",\"ph\":\"X\",\"ts\":" << s.start_us << ",\"dur\":" << s.duration_us
+            << ",\"pid\":1,\"tid\":" << s.thread_id << "}" << (i + 1 < spans.size() ? ",\n" : "\n");
+    }
+    out << "],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(out);
+}
+
+void Instrumentation::setSpanCallback(std::function<void(const TraceSpan&)> callback) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.callback = std::move(callback);
+    r.has_consumer = r.chrome_trace || static_cast<bool>(r.callback);
+}
+
+bool Instrumentation::tracing() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.has_consumer;
+}
+
+void Instrumentation::emitSpan(const TraceSpan& span) {
+    std::function<void(const TraceSpan&)> callback;
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.chrome_trace) {
+            r.spans.push_back(span);
+        }
+        callback = r.callback;
+    }
+
+    // 回调在锁外执行，允许其再次调用 Instrumentation
+    if (callback) {
+        callback(span);
+    }
+}
+
+double Instrumentation::nowMicros() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+double Instrumentation::processCpuMillis() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    auto toMs = [](const FILETIME& ft) {
+        ULARGE_INTEGER v;
+        v.LowPart = ft.dwLowDateTime;
+        v.HighPart = ft.dwHighDateTime;
+        return static_cast<double>(v.QuadPart) / 10000.0;  // 100ns -> ms
+    };
+    return toMs(kernel) + toMs(user);
+#else
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) {
+        return 0.0;
+    }
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+uint64_t Instrumentation::currentRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.WorkingSetSize;
+    }
+    return 0;
+#elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS) {
+        return info.resident_size;
+    }
+    return 0;
+#else
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (statm >> size >> resident) {
+        return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+    return 0;
+#endif
+}
+
+uint64_t Instrumentation::peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        return pmc.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);          // 字节
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // KB
+#endif
+#endif
+}
+
+uint64_t Instrumentation::currentThreadId() {
+    return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+// === StatsRecorder 实现 ===
+
+StatsRecorder::Scope::Scope(StatsRecorder* recorder, DecodeStage stage)
+    : recorder_(recorder)
+    , stage_(stage)
+{
+    if (recorder_) {
+        start_us_ = Instrumentation::nowMicros();
+        start_cpu_ms_ = Instrumentation::processCpuMillis();
+    }
+}
+
+StatsRecorder::Scope::Scope(Scope&& other) noexcept
+    : recorder_(other.recorder_)
+    , stage_(other.stage_)
+    , start_us_(other.start_us_)
+    , start_cpu_ms_(other.start_cpu_ms_)
+{
+    other.recorder_ = nullptr;
+}
+
+StatsRecorder::Scope::~Scope() {
+    if (!recorder_) {
+        return;
+    }
+
+    double end_us = Instrumentation::nowMicros();
+    recorder_->sampleRss();
+    StageTiming& timing = recorder_->current_.stage(stage_);
+    timing.wall_ms += (end_us - start_us_) / 1000.0;
+    timing.cpu_ms += Instrumentation::processCpuMillis() - start_cpu_ms_;
+    ++timing.calls;
+
+    if (Instrumentation::tracing()) {
+        TraceSpan span;
+        span.name = stageName(stage_);
+        span.category = recorder_->current_.operation;
+        span.start_us = start_us_;
+        span.duration_us = end_us - start_us_;
+        span.thread_id = Instrumentation::currentThreadId();
+        Instrumentation::emitSpan(span);
+    }
+}
+
+void StatsRecorder::begin(const char* operation, uint64_t bytes_read_so_far) {
+    if (!enabled_) {
+        return;
+    }
+    if (depth_++ > 0) {
+        return;  // 嵌套调用并入外层
+    }
+
+    current_ = DecodeStats();
+    current_.operation = operation;
+    start_us_ = Instrumentation::nowMicros();
+    start_cpu_ms_ = Instrumentation::processCpuMillis();
+    start_bytes_read_ = bytes_read_so_far;
+    start_rss_ = Instrumentation::currentRssBytes();
+    current_.peak_rss_bytes = start_rss_;
+}
+
+void StatsRecorder::end(uint64_t bytes_read_so_far) {
+    if (!enabled_ || depth_ == 0) {
+        return;
+    }
+    if (--depth_ > 0) {
+        return;
+    }
+
+    double end_us = Instrumentation::nowMicros();
+    current_.wall_ms = (end_us - start_us_) / 1000.0;
+    current_.cpu_ms = Instrumentation::processCpuMillis() - start_cpu_ms_;
+    current_.bytes_read = bytes_read_so_far >= start_bytes_read_ ? bytes_read_so_far - start_bytes_read_ : 0;
+    const uint64_t end_rss = Instrumentation::currentRssBytes();
+    current_.peak_rss_bytes = std::max(current_.peak_rss_bytes, end_rss);
+    current_.process_peak_rss_bytes = Instrumentation::peakRssBytes();
+    current_.rss_delta_bytes = static_cast<int64_t>(end_rss) - static_cast<int64_t>(start_rss_);
+
+    if (Instrumentation::tracing()) {
+        TraceSpan span;
+        span.name = current_.operation;
+        span.category = "pixraw";
+        span.start_us = start_us_;
+        span.duration_us = end_us - start_us_;
+        span.thread_id = Instrumentation::currentThreadId();
+        Instrumentation::emitSpan(span);
+    }
+
+    Instrumentation::record(current_);
+    last_ = current_;
+}
+
+void StatsRecorder::sampleRss() {
+    current_.peak_rss_bytes = std::max(current_.peak_rss_bytes, Instrumentation::currentRssBytes());
+}
+
+} // namespace PixRaw
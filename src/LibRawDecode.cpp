@@ -0,0 +1,130 @@
+#include "LibRawDecode.h"
+
+namespace PixRaw {
+
+RawMetadata readMetadata(const LibRaw &libraw) {
+  RawMetadata metadata;
+
+  // 图像尺寸
+  const libraw_image_sizes_t &sizes = libraw.imgdata.sizes;
+  metadata.image_width = sizes.width;
+  metadata.image_height = sizes.height;
+  metadata.raw_width = sizes.raw_width;
+  metadata.raw_height = sizes.raw_height;
+
+  // 相机信息
+  const libraw_iparams_t &idata = libraw.imgdata.idata;
+  metadata.camera_make = idata.make;
+  metadata.camera_model = idata.model;
+  metadata.software = idata.software;
+
+  // 拍摄参数
+  const libraw_imgother_t &other = libraw.imgdata.other;
+  metadata.iso = other.iso_speed;
+  metadata.shutter_speed = other.shutter;
+  metadata.aperture = other.aperture;
+  metadata.focal_length = other.focal_len;
+  metadata.timestamp = other.timestamp;
+
+  // 白平衡
+  const libraw_colordata_t &color = libraw.imgdata.color;
+  metadata.wb_red = color.cam_mul[0];
+  metadata.wb_green = color.cam_mul[1];
+  metadata.wb_blue = color.cam_mul[2];
+
+  return metadata;
+}
+
+template <typename Image>
+int decodeLinear(LibRaw &libraw, bool half_size, StatsRecorder &stats, Image &image, CameraColor &camera,
+                 std::string &error) {
+  // 设置输出参数
+  libraw_output_params_t &out_params = libraw.imgdata.params;
+  out_params.output_bps = 16;   // 16-bit per channel，在平面浮点图像中处理，输出时再量化
+  out_params.use_camera_wb = 1; // 使用相机白平衡（cam_mul）
+  out_params.use_auto_wb = 0;
+  out_params.user_mul[0] = out_params.user_mul[1] = out_params.user_mul[2] = out_params.user_mul[3] = 0.0f;
+
+  // 场景线性：不做自动亮度和曝光校正，白点固定，曝光/白平衡在缓存上调整
+  out_params.no_auto_bright = 1;
+  out_params.bright = 1.0f;
+  out_params.exp_correc = 0;
+  out_params.user_qual = 3;                 // AHD 算法，质量较好
+  out_params.half_size = half_size ? 1 : 0; // 使用 LibRaw 的 half_size 选项
+
+  // 输出线性数据，色彩变换由 ColorLut3D 完成
+  // 三色相机输出白平衡后的相机 RGB；其他（如四色）相机退回 LibRaw 的线性 sRGB
+  bool camera_space = libraw.imgdata.idata.colors == 3;
+  out_params.output_color = camera_space ? 0 : 1;
+  out_params.gamm[0] = 1.0;
+  out_params.gamm[1] = 1.0;
+
+  // 处理
+  int ret;
+  {
+    auto timer = stats.stage(DecodeStage::Process);
+    ret = libraw.dcraw_process();
+  }
+  if (ret != LIBRAW_SUCCESS) {
+    error = "Process failed: " + std::string(libraw_strerror(ret));
+    return ret;
+  }
+  stats.addAllocated(static_cast<uint64_t>(libraw.imgdata.sizes.iwidth) * libraw.imgdata.sizes.iheight * 4 *
+                     sizeof(unsigned short));
+
+  // 记录相机矩阵（白平衡后的相机 RGB -> 线性 sRGB）和实际使用的白平衡倍率
+  camera = CameraColor::identity();
+  if (camera_space) {
+    const libraw_colordata_t &color = libraw.imgdata.color;
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        camera.rgb_cam[i][j] = color.rgb_cam[i][j];
+      }
+    }
+    if (color.pre_mul[1] > 0.0f) {
+      for (int c = 0; c < 3; ++c) {
+        camera.cam_mul[c] = color.pre_mul[c] / color.pre_mul[1];
+      }
+    }
+  }
+
+  // 获取图像
+  libraw_processed_image_t *processed;
+  {
+    auto timer = stats.stage(DecodeStage::MakeImage);
+    processed = libraw.dcraw_make_mem_image(&ret);
+  }
+  // 工作图像已拷贝到输出，不再保留（再次调用时 dcraw_process() 重新生成）
+  libraw.free_image();
+  if (!processed) {
+    error = "Failed to create image";
+    return ret != LIBRAW_SUCCESS ? ret : LIBRAW_UNSPECIFIED_ERROR;
+  }
+  stats.addAllocated(processed->data_size);
+
+  // LibRaw 输出为紧密排列的交错 RGB，转换为平面格式
+  if (processed->type != LIBRAW_IMAGE_BITMAP || processed->colors != 3) {
+    error = "Unsupported image format";
+    LibRaw::dcraw_clear_mem(processed);
+    return LIBRAW_UNSPECIFIED_ERROR;
+  }
+
+  {
+    auto timer = stats.stage(DecodeStage::Convert);
+    image = Image::fromPacked(processed->data, processed->width, processed->height, processed->bits);
+  }
+  stats.addAllocated(image.byteSize());
+  LibRaw::dcraw_clear_mem(processed);
+
+  if (!image.isValid()) {
+    error = "Failed to copy image data";
+    return LIBRAW_UNSPECIFIED_ERROR;
+  }
+  return LIBRAW_SUCCESS;
+}
+
+template int decodeLinear<PlanarImage>(LibRaw &, bool, StatsRecorder &, PlanarImage &, CameraColor &, std::string &);
+template int decodeLinear<HalfPlanarImage>(LibRaw &, bool, StatsRecorder &, HalfPlanarImage &, CameraColor &,
+                                           std::string &);
+
+} // namespace PixRaw
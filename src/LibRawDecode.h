@@ -0,0 +1,39 @@
+#ifndef RAW_PROCESSOR_LIBRAW_DECODE_H
+#define RAW_PROCESSOR_LIBRAW_DECODE_H
+
+// 内部头文件：PixRaw 与 SharedRaw 共用的 LibRaw 解码步骤
+
+#include "ColorManagement.h"
+#include "HalfPlanarImage.h"
+#include "Instrumentation.h"
+#include "PlanarImage.h"
+#include "RawMetadata.h"
+#include <libraw/libraw.h>
+#include <string>
+
+namespace PixRaw {
+
+/**
+ * @brief 从已打开的 LibRaw 读取元数据
+ */
+RawMetadata readMetadata(const LibRaw &libraw);
+
+/**
+ * @brief 对已解包的 LibRaw 运行 dcraw_process()，输出线性相机 RGB 平面图像
+ *
+ * 可在同一次解包后以不同参数多次调用；返回前释放 LibRaw 的工作图像（imgdata.image），
+ * 调用之间只保留 RAW 数据。关闭自动亮度，输出为场景线性数据
+ * （相机白点 = 1.0），曝光和白平衡由 ColorLut3D 在缓存的线性图像上处理。
+ * Image 为 PlanarImage 或 HalfPlanarImage。
+ * @param half_size 使用 LibRaw 的 half_size 模式（宽高各减半，跳过去马赛克）
+ * @param image 输出线性图像（三色相机为白平衡后的相机 RGB，其他为线性 sRGB）
+ * @param camera 输出对应的相机矩阵和白平衡倍率
+ * @return LibRaw 返回码；非 LibRaw 错误返回 LIBRAW_UNSPECIFIED_ERROR，error 为错误信息
+ */
+template <typename Image>
+int decodeLinear(LibRaw &libraw, bool half_size, StatsRecorder &stats, Image &image, CameraColor &camera,
+                 std::string &error);
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_LIBRAW_DECODE_H
@@ -0,0 +1,301 @@
+#include "MemoryBudget.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace PixRaw {
+
+namespace {
+
+// 排队时轮询取消令牌的间隔（截止时间不会触发监听）
+constexpr std::chrono::milliseconds kWaitPoll(10);
+
+struct Entry {
+    std::string operation;
+    uint64_t bytes = 0;
+    bool in_flight = false;
+    bool downgraded = false;
+    double created_us = 0.0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::condition_variable changed;   // 预留减少、预算调整或队首变化时通知
+    MemoryBudgetOptions options;
+
+    std::map<uint64_t, Entry> entries;
+    uint64_t next_id = 1;
+    uint64_t reserved = 0;
+    uint64_t peak_reserved = 0;
+    int in_flight = 0;
+
+    std::deque<uint64_t> queue;        // 排队中的申请（票号），只有队首可以准入
+    uint64_t next_ticket = 1;
+
+    uint64_t admitted = 0;
+    uint64_t admitted_after_wait = 0;
+    uint64_t downgraded = 0;
+    uint64_t overcommitted = 0;
+    uint64_t cancelled = 0;
+    double wait_ms = 0.0;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// 调用方持有锁
+void setBytes(Registry& r, Entry& entry, uint64_t bytes) {
+    r.reserved = r.reserved - entry.bytes + bytes;
+    r.peak_reserved = std::max(r.peak_reserved, r.reserved);
+    entry.bytes = bytes;
+}
+
+void setInFlight(Registry& r, Entry& entry, bool in_flight) {
+    if (entry.in_flight != in_flight) {
+        r.in_flight += in_flight ? 1 : -1;
+        entry.in_flight = in_flight;
+    }
+}
+
+void erase(Registry& r, uint64_t id) {
+    auto it = r.entries.find(id);
+    if (it == r.entries.end()) {
+        return;
+    }
+    setBytes(r, it->second, 0);
+    setInFlight(r, it->second, false);
+    r.entries.erase(it);
+}
+
+uint64_t pixels(int width, int height) {
+    return static_cast<uint64_t>(std::max(0, width)) * static_cast<uint64_t>(std::max(0, height));
+}
+
+} // namespace
+
+// === MemoryReservation 实现 ===
+
+MemoryReservation::~MemoryReservation() {
+    release();
+}
+
+MemoryReservation::MemoryReservation(MemoryReservation&& other) noexcept
+    : id_(other.id_), downgraded_(other.downgraded_) {
+    other.id_ = 0;
+    other.downgraded_ = false;
+}
+
+MemoryReservation& MemoryReservation::operator=(MemoryReservation&& other) noexcept {
+    if (this != &other) {
+        release();
+        id_ = other.id_;
+        downgraded_ = other.downgraded_;
+        other.id_ = 0;
+        other.downgraded_ = false;
+    }
+    return *this;
+}
+
+bool MemoryReservation::acquire(const std::string& operation, uint64_t bytes, uint64_t fallback_bytes,
+                                const CancellationToken& token) {
+    Registry& r = registry();
+    std::unique_lock<std::mutex> lock(r.mutex);
+    if (id_ == 0) {
+        id_ = r.next_id++;
+        r.entries[id_].created_us = Instrumentation::nowMicros();
+    }
+    Entry& entry = r.entries[id_]; // std::map 的元素地址在插入/删除其他元素时保持不变
+    entry.operation = operation;
+    downgraded_ = false;
+
+    const uint64_t held = entry.bytes;
+    if (bytes <= held) {
+        entry.downgraded = false;
+        setInFlight(r, entry, true);
+        ++r.admitted;
+        return true;
+    }
+    const bool can_downgrade = r.options.allow_downgrade && fallback_bytes > 0 && fallback_bytes < bytes;
+
+    const uint64_t ticket = r.next_ticket++;
+    r.queue.push_back(ticket);
+    const double start_us = Instrumentation::nowMicros();
+    bool waited = false;
+
+    while (true) {
+        if (r.queue.front() == ticket) {
+            const uint64_t budget = r.options.budget_bytes;
+            auto fits = [&](uint64_t want) { return budget == 0 || r.reserved - held + want <= budget; };
+            uint64_t grant = 0;
+            if (fits(bytes)) {
+                grant = bytes;
+            } else if (can_downgrade && fits(fallback_bytes)) {
+                grant = fallback_bytes;
+                downgraded_ = true;
+            } else if (r.in_flight - (entry.in_flight ? 1 : 0) == 0) {
+                // 其余预留都是实例缓存，只有关闭实例才会释放，等待可能永远没有结果
+                grant = can_downgrade ? fallback_bytes : bytes;
+                downgraded_ = can_downgrade;
+                ++r.overcommitted;
+            }
+
+            if (grant > 0) {
+                setBytes(r, entry, std::max(grant, held));
+                setInFlight(r, entry, true);
+                entry.downgraded = downgraded_;
+                r.queue.pop_front();
+                if (waited) {
+                    ++r.admitted_after_wait;
+                    r.wait_ms += (Instrumentation::nowMicros() - start_us) / 1000.0;
+                } else {
+                    ++r.admitted;
+                }
+                if (downgraded_) {
+                    ++r.downgraded;
+                }
+                r.changed.notify_all(); // 新的队首重新检查
+                return true;
+            }
+        }
+
+        if (token.isCancelled()) {
+            r.queue.erase(std::find(r.queue.begin(), r.queue.end(), ticket));
+            ++r.cancelled;
+            if (waited) {
+                r.wait_ms += (Instrumentation::nowMicros() - start_us) / 1000.0;
+            }
+            if (held == 0 && !entry.in_flight) {
+                erase(r, id_);
+                id_ = 0;
+            }
+            r.changed.notify_all();
+            return false;
+        }
+        waited = true;
+        if (token.canBeCancelled()) {
+            r.changed.wait_for(lock, kWaitPoll);
+        } else {
+            r.changed.wait(lock);
+        }
+    }
+}
+
+void MemoryReservation::settle(uint64_t retained_bytes) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (id_ == 0) {
+        if (retained_bytes == 0) {
+            return;
+        }
+        id_ = r.next_id++;
+        r.entries[id_].created_us = Instrumentation::nowMicros();
+    }
+    auto it = r.entries.find(id_);
+    if (retained_bytes == 0) {
+        erase(r, id_);
+        id_ = 0;
+    } else if (it != r.entries.end()) {
+        setBytes(r, it->second, retained_bytes);
+        setInFlight(r, it->second, false);
+    }
+    r.changed.notify_all();
+}
+
+void MemoryReservation::release() {
+    if (id_ == 0) {
+        return;
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    erase(r, id_);
+    id_ = 0;
+    downgraded_ = false;
+    r.changed.notify_all();
+}
+
+uint64_t MemoryReservation::bytes() const {
+    if (id_ == 0) {
+        return 0;
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.entries.find(id_);
+    return it != r.entries.end() ? it->second.bytes : 0;
+}
+
+// === MemoryBudget 实现 ===
+
+void MemoryBudget::setOptions(const MemoryBudgetOptions& options) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.options = options;
+    r.changed.notify_all();
+}
+
+MemoryBudgetOptions MemoryBudget::options() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.options;
+}
+
+MemoryBudgetStats MemoryBudget::stats() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    const double now_us = Instrumentation::nowMicros();
+
+    MemoryBudgetStats s;
+    s.budget_bytes = r.options.budget_bytes;
+    s.reserved_bytes = r.reserved;
+    s.peak_reserved_bytes = r.peak_reserved;
+    s.in_flight = r.in_flight;
+    s.queued = static_cast<int>(r.queue.size());
+    s.admitted = r.admitted;
+    s.admitted_after_wait = r.admitted_after_wait;
+    s.downgraded = r.downgraded;
+    s.overcommitted = r.overcommitted;
+    s.cancelled = r.cancelled;
+    s.wait_ms = r.wait_ms;
+    s.reservations.reserve(r.entries.size());
+    for (const auto& item : r.entries) {
+        MemoryReservationInfo info;
+        info.id = item.first;
+        info.operation = item.second.operation;
+        info.bytes = item.second.bytes;
+        info.in_flight = item.second.in_flight;
+        info.downgraded = item.second.downgraded;
+        info.age_ms = (now_us - item.second.created_us) / 1000.0;
+        s.reservations.push_back(std::move(info));
+    }
+    return s;
+}
+
+MemoryEstimate MemoryBudget::estimateDecode(const RawMetadata& metadata, bool half_size) {
+    int width = metadata.image_width;
+    int height = metadata.image_height;
+    if (half_size) {
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+    const uint64_t image = pixels(width, height);
+
+    MemoryEstimate estimate;
+    estimate.raw_bytes = pixels(metadata.raw_width, metadata.raw_height) * 2;
+    estimate.processed_bytes = image * 4 * sizeof(uint16_t);
+    estimate.cache_bytes = image * 3 * sizeof(uint16_t);
+    // dcraw_make_mem_image() 的 16 位输出只在转换期间存在，之后才渲染
+    estimate.transient_bytes = std::max(image * 3 * sizeof(uint16_t), estimateRender(width, height));
+    return estimate;
+}
+
+uint64_t MemoryBudget::estimateRender(int width, int height) {
+    return pixels(width, height) * (3 * sizeof(float) + 3);
+}
+
+} // namespace PixRaw
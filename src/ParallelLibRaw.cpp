@@ -0,0 +1,259 @@
+// 解码器指针和 get4()/read_shorts() 等成员只在库内部构建时声明，与 LibRaw 自身的编译方式一致
+#define LIBRAW_LIBRARY_BUILD
+#include "ParallelLibRaw.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace PixRaw {
+
+namespace {
+
+constexpr int kRowBlock = 256; // 每次读入并并行解压的行数
+
+// 与 LibRaw 的 ph1_bits() 相同：按文件字节序读取 32 位字，从高位开始取位
+class PhaseOneBits {
+public:
+  PhaseOneBits(const uint8_t *data, size_t size, bool little_endian)
+      : data_(data), size_(size), little_endian_(little_endian) {}
+
+  unsigned get(int n) {
+    if (n == 0) {
+      return 0;
+    }
+    if (vbits_ < n) {
+      bitbuf_ = bitbuf_ << 32 | word();
+      vbits_ += 32;
+    }
+    unsigned c = static_cast<unsigned>(bitbuf_ << (64 - vbits_) >> (64 - n));
+    vbits_ -= n;
+    return c;
+  }
+
+private:
+  uint32_t word() {
+    // 超出数据时与 LibRaw 在文件末尾的 get4() 一致
+    if (pos_ + 4 > size_) {
+      return 0xffffffffu;
+    }
+    const uint8_t *p = data_ + pos_;
+    pos_ += 4;
+    if (little_endian_) {
+      return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+    return static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+  }
+
+  const uint8_t *data_;
+  size_t size_;
+  size_t pos_ = 0;
+  bool little_endian_;
+  uint64_t bitbuf_ = 0;
+  int vbits_ = 0;
+};
+
+// 一行解压前后的长度状态
+struct RowState {
+  int len[2] = {14, 14};         // 传入上一行结束时的长度，解压后为本行结束时的长度
+  bool keep[2] = {false, false}; // 第 0 列的长度码是否沿用传入的长度
+  int errors = 0;                // 数据错误数
+};
+
+// 解压一行（phase_one_load_raw_c() 的行循环）
+void decodeRow(PhaseOneBits &bits, int raw_width, int format, const ushort *curve, RowState &state, ushort *out) {
+  static const int kLength[] = {8, 7, 6, 9, 11, 10, 5, 12, 14, 13};
+
+  int *len = state.len;
+  int pred[2] = {0, 0};
+  int errors = 0;
+  const int packed = raw_width & -8;
+  for (int col = 0; col < raw_width; ++col) {
+    if (col >= packed) {
+      len[0] = len[1] = 14;
+    } else if ((col & 7) == 0) {
+      for (int i = 0; i < 2; ++i) {
+        int j = 0;
+        while (j < 5 && !bits.get(1)) {
+          ++j;
+        }
+        if (j--) {
+          len[i] = kLength[j * 2 + bits.get(1)];
+        } else if (col == 0) {
+          state.keep[i] = true;
+        }
+      }
+    }
+
+    const int parity = col & 1;
+    const int n = len[parity];
+    if (n == 14) {
+      pred[parity] = static_cast<int>(bits.get(16));
+    } else {
+      pred[parity] = static_cast<int>(static_cast<unsigned>(pred[parity]) + bits.get(n) + 1u - (1u << (n - 1)));
+    }
+    if (pred[parity] >> 16) {
+      ++errors;
+    }
+    ushort value = static_cast<ushort>(pred[parity]);
+    if (format == 5 && value < 256) {
+      value = curve[value];
+    }
+    out[col] = value;
+  }
+
+  if (format != 8) {
+    for (int col = 0; col < raw_width; ++col) {
+      out[col] = static_cast<ushort>(out[col] << 2);
+    }
+  }
+  state.errors = errors;
+}
+
+// 读取 [offset, offset + size)，超出文件的部分按 LibRaw 在文件末尾读到的值填充
+void readRange(LibRaw_abstract_datastream *input, INT64 file_size, INT64 offset, uint8_t *dst, size_t size) {
+  size_t got = 0;
+  if (offset >= 0 && offset < file_size) {
+    input->seek(offset, SEEK_SET);
+    int n = input->read(dst, 1, size);
+    got = n > 0 ? static_cast<size_t>(n) : 0;
+  }
+  std::memset(dst + got, 0xff, size - got);
+}
+
+} // namespace
+
+int ParallelLibRaw::unpack() {
+  if (!parallel_unpack_ || load_raw != &ParallelLibRaw::phase_one_load_raw_c ||
+      imgdata.color.phase_one_data.format == 6) {
+    return LibRaw::unpack();
+  }
+
+  // 只在本次 unpack() 内替换解码器，LibRaw 的分配、黑电平和错误处理保持不变；
+  // phaseOneLoadRaw() 一进入就恢复原指针，之后的 is_phaseone_compressed() 等判断不受影响
+  load_raw = static_cast<void (LibRaw::*)()>(&ParallelLibRaw::phaseOneLoadRaw);
+  int ret = LibRaw::unpack();
+  load_raw = &ParallelLibRaw::phase_one_load_raw_c;
+  return ret;
+}
+
+void ParallelLibRaw::phaseOneLoadRaw() {
+  load_raw = &ParallelLibRaw::phase_one_load_raw_c;
+
+  const int raw_width = imgdata.sizes.raw_width;
+  const int raw_height = imgdata.sizes.raw_height;
+  const ph1_t &ph1 = imgdata.color.phase_one_data;
+  ushort *raw_image = imgdata.rawdata.raw_image;
+  LibRaw_abstract_datastream *input = libraw_internal_data.internal_data.input;
+  const INT64 data_offset = libraw_internal_data.unpacker_data.data_offset;
+  const bool little_endian = libraw_internal_data.unpacker_data.order == 0x4949;
+
+  // 行偏移表（相对 data_offset）
+  std::vector<int> offsets(raw_height);
+  input->seek(libraw_internal_data.unpacker_data.strip_offset, SEEK_SET);
+  for (int &offset : offsets) {
+    offset = static_cast<int>(get4());
+  }
+
+  // 列/行黑电平表保存到 rawdata，之后由 LibRaw 扣除
+  if (ph1.black_col || ph1.black_row) {
+    std::vector<ushort> col_black(static_cast<size_t>(raw_height) * 2, 0);
+    std::vector<ushort> row_black(static_cast<size_t>(raw_width) * 2, 0);
+    if (ph1.black_col) {
+      input->seek(ph1.black_col, SEEK_SET);
+      read_shorts(col_black.data(), raw_height * 2);
+    }
+    if (ph1.black_row) {
+      input->seek(ph1.black_row, SEEK_SET);
+      read_shorts(row_black.data(), raw_width * 2);
+    }
+    imgdata.rawdata.ph1_cblack = static_cast<short(*)[2]>(calloc(col_black.size(), sizeof(ushort)));
+    imgdata.rawdata.ph1_rblack = static_cast<short(*)[2]>(calloc(row_black.size(), sizeof(ushort)));
+    if (!imgdata.rawdata.ph1_cblack || !imgdata.rawdata.ph1_rblack) {
+      throw LIBRAW_EXCEPTION_ALLOC;
+    }
+    std::memcpy(imgdata.rawdata.ph1_cblack, col_black.data(), col_black.size() * sizeof(ushort));
+    std::memcpy(imgdata.rawdata.ph1_rblack, row_black.data(), row_black.size() * sizeof(ushort));
+  }
+
+  ushort *curve = imgdata.color.curve;
+  for (int i = 0; i < 256; ++i) {
+    curve[i] = static_cast<ushort>(i * i / 3.969 + 0.5);
+  }
+
+  // 一行最多 16 位/像素，另加每 8 列两个长度码（各不超过 6 位）和预读的一个字
+  const size_t max_row_bytes = static_cast<size_t>(raw_width) * 2 + raw_width / 4 + 8;
+  const INT64 file_size = input->size();
+  std::vector<uint8_t> buffer;
+  std::vector<size_t> starts(kRowBlock);
+  std::vector<RowState> states(kRowBlock);
+  int carry[2] = {14, 14}; // 上一行结束时的长度（LibRaw 第一行之前的 len[] 未初始化，这里取 14）
+  int errors = 0;
+
+  for (int first = 0; first < raw_height; first += kRowBlock) {
+    checkCancel();
+    const int last = std::min(raw_height, first + kRowBlock);
+    const int rows = last - first;
+
+    // 各行通常连续存放，整块一次读入；偏移乱序或跨度异常时逐行读入
+    INT64 lo = offsets[first];
+    INT64 hi = offsets[first];
+    for (int row = first + 1; row < last; ++row) {
+      lo = std::min<INT64>(lo, offsets[row]);
+      hi = std::max<INT64>(hi, offsets[row]);
+    }
+    const size_t block_bytes = static_cast<size_t>(rows) * max_row_bytes;
+    if (static_cast<uint64_t>(hi - lo) + max_row_bytes <= block_bytes) {
+      buffer.resize(static_cast<size_t>(hi - lo) + max_row_bytes);
+      readRange(input, file_size, data_offset + lo, buffer.data(), buffer.size());
+      for (int row = first; row < last; ++row) {
+        starts[row - first] = static_cast<size_t>(offsets[row] - lo);
+      }
+    } else {
+      buffer.resize(block_bytes);
+      for (int row = first; row < last; ++row) {
+        starts[row - first] = static_cast<size_t>(row - first) * max_row_bytes;
+        readRange(input, file_size, data_offset + offsets[row], buffer.data() + starts[row - first], max_row_bytes);
+      }
+    }
+
+    const uint8_t *data = buffer.data();
+    const size_t size = buffer.size();
+    auto decode = [&](int row) {
+      const size_t start = starts[row - first];
+      PhaseOneBits bits(data + start, size - start, little_endian);
+      decodeRow(bits, raw_width, ph1.format, curve, states[row - first], raw_image + static_cast<size_t>(row) * raw_width);
+    };
+
+    // 先假定每行从长度 14 开始并行解压
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int row = first; row < last; ++row) {
+      states[row - first] = RowState();
+      decode(row);
+    }
+
+    // LibRaw 的 len[] 跨行保留：第 0 列沿用长度的行依赖上一行结束时的长度。正常文件每行开头
+    // 都给出长度码；截断文件按 0xff 填充的部分全是沿用码。假定不成立的行按顺序重新解压
+    for (int row = first; row < last; ++row) {
+      RowState &state = states[row - first];
+      if ((state.keep[0] && carry[0] != 14) || (state.keep[1] && carry[1] != 14)) {
+        state = RowState();
+        state.len[0] = carry[0];
+        state.len[1] = carry[1];
+        decode(row);
+      }
+      carry[0] = state.len[0];
+      carry[1] = state.len[1];
+      errors += state.errors;
+    }
+  }
+
+  if (errors > 0) {
+    derror();
+  }
+  imgdata.color.maximum = 0xfffc - ph1.t_black;
+}
+
+} // namespace PixRaw
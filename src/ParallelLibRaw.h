@@ -0,0 +1,39 @@
+#ifndef RAW_PROCESSOR_PARALLEL_LIBRAW_H
+#define RAW_PROCESSOR_PARALLEL_LIBRAW_H
+
+// 内部头文件：PixRaw 与 SharedRaw 使用的 LibRaw 子类，对部分格式并行解包
+
+#include <libraw/libraw.h>
+
+namespace PixRaw {
+
+/**
+ * @brief 并行解包的 LibRaw
+ *
+ * Phase One / Leaf 压缩 IIQ（phase_one_load_raw_c）的行偏移表给出每行独立的起点。
+ * unpack() 按行块把压缩数据读入内存，再用 OpenMP 按行并行解压；第 0 列沿用上一行长度码的行
+ * 随后按顺序重新解压，结果与 LibRaw 的单线程解码器一致。其他格式直接调用 LibRaw::unpack()。
+ */
+class ParallelLibRaw : public LibRaw {
+public:
+  // 隐藏 LibRaw::unpack()（非虚函数），需通过 ParallelLibRaw 调用
+  int unpack();
+
+  /**
+   * @brief 是否使用并行解码器（默认开启；关闭时使用 LibRaw 自带的单线程解码器）
+   */
+  void setParallelUnpack(bool enabled) { parallel_unpack_ = enabled; }
+  bool isParallelUnpack() const { return parallel_unpack_; }
+
+  // Fuji SuperCCD 的旋转排列：COLOR() 按 fuji_width 换算坐标，颜色没有固定周期
+  bool isFujiRotated() const { return libraw_internal_data.internal_output_params.fuji_width != 0; }
+
+private:
+  void phaseOneLoadRaw();
+
+  bool parallel_unpack_ = true;
+};
+
+} // namespace PixRaw
+
+#endif // RAW_PROCESSOR_PARALLEL_LIBRAW_H
@@ -1,230 +1,367 @@
 #include "PixRaw.h"
+#include "Cancellation.h"
+#include "ColorManagement.h"
 #include "ImageAdjuster.h"
+#include "ImageSignature.h"
+#include "Instrumentation.h"
+#include "LibRawDecode.h"
+#include "MemoryBudget.h"
+#include "ParallelLibRaw.h"
+#include "PlanarImage.h"
 #include "RawData.h"
+#include "Rendition.h"
+#include "SmartPreview.h"
 #include <algorithm>
 #include <cstring>
 #include <libraw/libraw.h>
 
 namespace PixRaw {
 
+namespace {
+
+// 统计读取字节数的文件数据流（仅在启用插桩时使用）
+class CountingFileDatastream : public LibRaw_bigfile_datastream {
+public:
+  explicit CountingFileDatastream(const char *fname) : LibRaw_bigfile_datastream(fname) {}
+
+  int read(void *ptr, size_t size, size_t nmemb) override {
+    int items = LibRaw_bigfile_datastream::read(ptr, size, nmemb);
+    if (items > 0) {
+      bytes_ += static_cast<uint64_t>(items) * size;
+    }
+    return items;
+  }
+
+  int get_char() override {
+    int c = LibRaw_bigfile_datastream::get_char();
+    if (c >= 0) {
+      ++bytes_;
+    }
+    return c;
+  }
+
+  // 文本读取（部分格式的头部解析）按文件位置的前进量计数
+  int scanf_one(const char *fmt, void *val) override {
+    INT64 start = tell();
+    int ret = LibRaw_bigfile_datastream::scanf_one(fmt, val);
+    countSince(start);
+    return ret;
+  }
+
+  char *gets(char *str, int sz) override {
+    INT64 start = tell();
+    char *ret = LibRaw_bigfile_datastream::gets(str, sz);
+    countSince(start);
+    return ret;
+  }
+
+  uint64_t bytes() const { return bytes_; }
+
+private:
+  void countSince(INT64 start) {
+    INT64 end = tell();
+    if (start >= 0 && end > start) {
+      bytes_ += static_cast<uint64_t>(end - start);
+    }
+  }
+
+  uint64_t bytes_ = 0;
+};
+
+// RAW CFA 的颜色排列：0=R, 1=G（第二绿色并入绿色）, 2=B，单色传感器为 kGrey
+// Bayer（8x2）、X-Trans（6x6）和 Leaf（16x16）的周期都整除 kPeriod，按表查找；
+// 没有固定周期的排列（Fuji SuperCCD）逐像素调用 COLOR()
+class CfaPattern {
+public:
+  static constexpr int kPeriod = 48;
+  static constexpr int kGrey = 3;
+
+  explicit CfaPattern(ParallelLibRaw &libraw) : libraw_(libraw) {
+    monochrome_ = libraw.imgdata.idata.filters == 0;
+    periodic_ = monochrome_ || !libraw.isFujiRotated();
+    if (!periodic_) {
+      return;
+    }
+    for (int r = 0; r < kPeriod; ++r) {
+      for (int c = 0; c < kPeriod; ++c) {
+        table_[r][c] = static_cast<int8_t>(monochrome_ ? kGrey : normalize(libraw.COLOR(r, c)));
+      }
+    }
+  }
+
+  bool monochrome() const { return monochrome_; }
+
+  // 第 y 行的颜色表（按 x % kPeriod 索引）；没有固定周期时返回 nullptr，改用 at()
+  const int8_t *row(int y) const { return periodic_ ? table_[y % kPeriod] : nullptr; }
+
+  int at(int y, int x) const {
+    return periodic_ ? table_[y % kPeriod][x % kPeriod] : normalize(libraw_.COLOR(y, x));
+  }
+
+  // 颜色对应的黑电平通道（cblack 下标）
+  static int blackChannel(int color) { return color == kGrey ? 0 : color; }
+
+private:
+  // 第二绿色并入绿色，其他超出 0..3 的值钳位
+  static int normalize(int color) {
+    color = std::min(std::max(color, 0), 3);
+    return color == 3 ? 1 : color;
+  }
+
+  ParallelLibRaw &libraw_;
+  bool monochrome_ = false;
+  bool periodic_ = true;
+  int8_t table_[kPeriod][kPeriod];
+};
+
+} // namespace
+
 // Pimpl 实现类
 class PixRaw::Impl {
 public:
-  Impl() : libraw_(std::make_unique<LibRaw>()), open_(false) {}
+  Impl() : libraw_(std::make_unique<ParallelLibRaw>()), open_(false) {
+    // 进度回调在 LibRaw 各处理阶段之间检查当前调用的取消令牌
+    libraw_->set_progress_handler(&Impl::progressCallback, this);
+  }
 
   bool open(const std::string &filepath) {
     close(); // 这会清除缓存
 
-#ifdef _WIN32
-    // Windows: 宽字符
-    int ret = libraw_->open_file(filepath.c_str());
-#else
-    int ret = libraw_->open_file(filepath.c_str());
-#endif
+    CallScope call(*this, "open");
+    auto timer = stats_.stage(DecodeStage::Open);
+
+    if (SmartPreview::isSmartPreviewFile(filepath)) {
+      std::string error;
+      return openSmartPreview(SmartPreview::open(filepath, &error), error);
+    }
+
+    int ret;
+    if (stats_.isEnabled()) {
+      // 启用插桩时通过计数数据流打开，以统计读取字节数
+      stream_ = std::make_unique<CountingFileDatastream>(filepath.c_str());
+      ret = stream_->valid() ? libraw_->open_datastream(stream_.get()) : LIBRAW_IO_ERROR;
+    } else {
+      ret = libraw_->open_file(filepath.c_str());
+    }
 
     if (ret != LIBRAW_SUCCESS) {
-      error_ = "Failed to open file: " + std::string(libraw_strerror(ret));
+      stream_.reset();
+      fail("Failed to open file: " + std::string(libraw_strerror(ret)));
       return false;
     }
 
     open_ = true;
     error_.clear();
+    status_ = DecodeStatus::Success;
     return true;
   }
 
-  bool open(const std::wstring &filepath) {
+  bool openBuffer(const void *data, size_t size) {
     close();
 
-#ifdef _WIN32
-    int ret = libraw_->open_file(filepath.c_str());
-#else
-    // 非 Windows 系统转换宽字符为 UTF-8
-    // 简化处理，实际需要转换
-    return false;
-#endif
+    CallScope call(*this, "openBuffer");
+    auto timer = stats_.stage(DecodeStage::Open);
+
+    if (!data || size == 0) {
+      fail("Invalid buffer");
+      return false;
+    }
+
+    if (SmartPreview::isSmartPreview(data, size)) {
+      std::string error;
+      if (!openSmartPreview(SmartPreview::openBuffer(data, size, &error), error)) {
+        return false;
+      }
+      buffer_bytes_ = size;
+      return true;
+    }
 
+    // LibRaw 直接读取调用者的缓冲区，不做拷贝
+    int ret = libraw_->open_buffer(data, size);
     if (ret != LIBRAW_SUCCESS) {
-      error_ = "Failed to open file";
+      fail("Failed to open buffer: " + std::string(libraw_strerror(ret)));
       return false;
     }
+    buffer_bytes_ = size;
 
     open_ = true;
     error_.clear();
+    status_ = DecodeStatus::Success;
     return true;
   }
 
-  RawMetadata getMetadata() const {
-    RawMetadata metadata;
-
-    if (!open_) {
-      return metadata;
+  bool open(PrefetchedFile file) {
+    if (!file.isValid()) {
+      close();
+      CallScope call(*this, "open");
+      fail(file.error().empty() ? "Invalid prefetched file" : file.error());
+      return false;
     }
 
-    // 图像尺寸
-    libraw_image_sizes_t &sizes = libraw_->imgdata.sizes;
-    metadata.image_width = sizes.width;
-    metadata.image_height = sizes.height;
-    metadata.raw_width = sizes.raw_width;
-    metadata.raw_height = sizes.raw_height;
+    // 移动不改变缓冲区地址；openBuffer 会先 close() 上一个文件，成功后再接管
+    PrefetchedFile owned = std::move(file);
+    if (!openBuffer(owned.data(), owned.size())) {
+      return false;
+    }
+    prefetched_ = std::move(owned);
+    return true;
+  }
 
-    // 相机信息
-    libraw_iparams_t &idata = libraw_->imgdata.idata;
-    metadata.camera_make = idata.make;
-    metadata.camera_model = idata.model;
-    metadata.software = idata.software;
+  bool open(const std::wstring &filepath) {
+    close();
 
-    // 拍摄参数
-    libraw_imgother_t &other = libraw_->imgdata.other;
-    metadata.iso = other.iso_speed;
-    metadata.shutter_speed = other.shutter;
-    metadata.aperture = other.aperture;
-    metadata.focal_length = other.focal_len;
-    metadata.timestamp = other.timestamp;
+#ifndef _WIN32
+    // 非 Windows 系统转换宽字符为 UTF-8
+    // 简化处理，实际需要转换
+    (void)filepath;
+    fail("Wide-character paths are not supported on this platform");
+    return false;
+#else
+    int ret = libraw_->open_file(filepath.c_str());
 
-    // 白平衡
-    libraw_colordata_t &color = libraw_->imgdata.color;
-    metadata.wb_red = color.cam_mul[0];
-    metadata.wb_green = color.cam_mul[1];
-    metadata.wb_blue = color.cam_mul[2];
+    if (ret != LIBRAW_SUCCESS) {
+      fail("Failed to open file");
+      return false;
+    }
 
-    return metadata;
+    open_ = true;
+    error_.clear();
+    status_ = DecodeStatus::Success;
+    return true;
+#endif
   }
 
-  RawImage decodePreview(int max_width, int max_height) {
+  RawMetadata getMetadata() const {
     if (!open_) {
-      error_ = "No file opened";
-      return RawImage();
+      return RawMetadata();
     }
-
-    // 如果已经解码过，并且有缓存，直接使用缓存
-    if (image_decoded_ && cached_image_.isValid()) {
-      // 应用当前的调整参数
-      if (adjustments_.hasAdjustments()) {
-        return ImageAdjuster::applyAdjustments(cached_image_, adjustments_);
-      }
-      // 如果没有调整，返回缓存的副本
-      RawImage result(cached_image_.width(), cached_image_.height(), cached_image_.format());
-      int dataSize = cached_image_.width() * cached_image_.height() * cached_image_.bytesPerPixel();
-      std::memcpy(result.data(), cached_image_.data(), dataSize);
-      return result;
+    if (smart_preview_) {
+      return smart_preview_->metadata();
     }
+    return readMetadata(*libraw_);
+  }
 
-    // 首次解码
-    // 获取原始图像尺寸
-    libraw_image_sizes_t &sizes = libraw_->imgdata.sizes;
-    int original_width = sizes.width;
-    int original_height = sizes.height;
-
-    // 计算缩放比例，保持宽高比
-    double scale = 1.0;
-    if (max_width > 0 && max_height > 0) {
-      double scale_width = static_cast<double>(max_width) / original_width;
-      double scale_height = static_cast<double>(max_height) / original_height;
-      scale = (scale_width < scale_height) ? scale_width : scale_height;
-
-      // 如果图像比目标尺寸小，不放大
-      if (scale > 1.0) {
-        scale = 1.0;
-      }
+  RawImage decodePreview(int max_width, int max_height, const CancellationToken &token) {
+    CancelScope scope(*this, token);
+    if (!open_) {
+      fail("No file opened");
+      return RawImage();
     }
 
-    // 设置输出参数
-    libraw_output_params_t &out_params = libraw_->imgdata.params;
-    out_params.output_bps = 8;    // 8-bit per channel
-    out_params.use_camera_wb = 1; // 使用相机白平衡
-    out_params.use_auto_wb = 0;
-    out_params.user_qual = 3;                     // AHD 算法，质量较好
-    out_params.half_size = (scale < 0.6) ? 1 : 0; // 使用 LibRaw 的 half_size 选项
-
-    // 解包
-    int ret = libraw_->unpack();
-    if (ret != LIBRAW_SUCCESS) {
-      error_ = "Unpack failed: " + std::string(libraw_strerror(ret));
+    CallScope call(*this, "decodePreview");
+    if (cancelled()) {
       return RawImage();
     }
 
-    // 处理
-    ret = libraw_->dcraw_process();
-    if (ret != LIBRAW_SUCCESS) {
-      error_ = "Process failed: " + std::string(libraw_strerror(ret));
+    MemoryScope memory(*this);
+    bool half_size = previewScale(max_width, max_height) < 0.6;
+    if (!reserveMemory("decodePreview", half_size)) {
       return RawImage();
     }
-
-    // 获取图像
-    libraw_processed_image_t *image = libraw_->dcraw_make_mem_image(&ret);
-    if (!image) {
-      error_ = "Failed to create image";
+    if (!ensureDecoded(half_size) || cancelled()) {
       return RawImage();
     }
+    return renderCached();
+  }
 
-    // 转换为 RawImage 并缓存
-    if (image->type == LIBRAW_IMAGE_BITMAP && image->colors == 3) {
-      int width = image->width;
-      int height = image->height;
-      int data_size = width * height * 3;
-
-      cached_image_ = RawImage(width, height, PixelFormat::RGB888);
+  std::vector<RawImage> decodeRenditions(const std::vector<RenditionSpec> &specs, const CancellationToken &token) {
+    CancelScope scope(*this, token);
+    if (!open_) {
+      fail("No file opened");
+      return {};
+    }
+    if (specs.empty()) {
+      fail("No renditions requested");
+      return {};
+    }
 
-      // 确保数据被正确拷贝
-      if (cached_image_.data() && image->data) {
-        std::memcpy(cached_image_.data(), image->data, data_size);
-        image_decoded_ = true;
-      } else {
-        error_ = "Failed to copy image data";
-      }
-    } else {
-      error_ = "Unsupported image format";
-      LibRaw::dcraw_clear_mem(image);
-      return RawImage();
+    CallScope call(*this, "decodeRenditions");
+    if (cancelled()) {
+      return {};
     }
 
-    LibRaw::dcraw_clear_mem(image);
+    // 按最大的输出版本决定是否使用 half_size，所有版本共用一次解码和一次色彩/调整渲染
+    double scale = 0.0;
+    for (const RenditionSpec &spec : specs) {
+      scale = std::max(scale, previewScale(spec.max_width, spec.max_height));
+    }
+    MemoryScope memory(*this);
+    bool half_size = scale < 0.6;
+    if (!reserveMemory("decodeRenditions", half_size)) {
+      return {};
+    }
+    if (!ensureDecoded(half_size) || cancelled()) {
+      return {};
+    }
 
-    // 应用调整参数
-    if (cached_image_.isValid() && adjustments_.hasAdjustments()) {
-      return ImageAdjuster::applyAdjustments(cached_image_, adjustments_);
+    PlanarImage working;
+    if (!renderWorking(working)) {
+      return {};
     }
 
-    // 返回缓存的副本
-    RawImage result(cached_image_.width(), cached_image_.height(), cached_image_.format());
-    int dataSize = cached_image_.width() * cached_image_.height() * cached_image_.bytesPerPixel();
-    std::memcpy(result.data(), cached_image_.data(), dataSize);
+    auto timer = stats_.stage(DecodeStage::Output);
+    std::vector<RawImage> result = RenditionRenderer::render(working, specs, token_);
+    if (result.empty()) {
+      if (!cancelled()) {
+        fail("Failed to create output image");
+      }
+      return {};
+    }
+    for (const RawImage &image : result) {
+      stats_.addAllocated(image.byteSize());
+    }
     return result;
   }
 
-  RawImage decodeFull() {
-    return decodePreview(0, 0); // 全尺寸，不限制
+  RawImage decodeFull(const CancellationToken &token) {
+    return decodePreview(0, 0, token); // 全尺寸，不限制
   }
 
-  RawImage decodeQuickPreview() {
+  RawImage decodeQuickPreview(const CancellationToken &token) {
     // 超快速预览：320x240（约 7万像素）
     // 使用去马赛克快速算法或下采样
-    return decodePreview(320, 240);
+    return decodePreview(320, 240, token);
   }
 
-  RawImage decodeMediumPreview() {
+  RawImage decodeMediumPreview(const CancellationToken &token) {
     // 中等预览：1280x720（约 92万像素）
     // 平衡质量和速度
-    return decodePreview(1280, 720);
+    return decodePreview(1280, 720, token);
   }
 
-  RawImage getThumbnail() {
+  RawImage getThumbnail(const CancellationToken &token) {
+    CancelScope scope(*this, token);
     if (!open_) {
-      error_ = "No file opened";
+      fail("No file opened");
       return RawImage();
     }
 
-    int ret = libraw_->unpack_thumb();
-    if (ret != LIBRAW_SUCCESS) {
+    CallScope call(*this, "getThumbnail");
+    if (cancelled()) {
+      return RawImage();
+    }
+    if (smart_preview_) {
+      return decodePreview(480, 480, token);
+    }
+
+    int ret;
+    libraw_processed_image_t *thumb = nullptr;
+    {
+      auto timer = stats_.stage(DecodeStage::Thumbnail);
+      ret = libraw_->unpack_thumb();
+      if (ret == LIBRAW_SUCCESS) {
+        thumb = libraw_->dcraw_make_mem_thumb(&ret);
+      }
+    }
+    if (ret != LIBRAW_SUCCESS && !thumb) {
       // 如果解包缩略图失败，尝试使用小尺寸预览
       // 某些相机可能没有嵌入缩略图
-      return decodePreview(480, 480); // 返回小尺寸预览，最大边480
+      return decodePreview(480, 480, token); // 返回小尺寸预览，最大边480
     }
 
-    libraw_processed_image_t *thumb = libraw_->dcraw_make_mem_thumb(&ret);
     if (!thumb) {
       // 如果创建缩略图失败，使用小尺寸预览
-      return decodePreview(480, 480);
+      return decodePreview(480, 480, token);
     }
 
     RawImage result;
@@ -233,48 +370,58 @@ public:
       // 注意：这里假设 Qt 可用，在纯 C++ 环境需要其他 JPEG 库
       // 暂时返回空，让调用者使用 decodePreview
       LibRaw::dcraw_clear_mem(thumb);
-      return decodePreview(480, 480); // 返回小尺寸快速预览
+      return decodePreview(480, 480, token); // 返回小尺寸快速预览
     } else if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->colors == 3) {
       int width = thumb->width;
       int height = thumb->height;
-      int data_size = width * height * 3;
 
       result = RawImage(width, height, PixelFormat::RGB888);
 
-      if (result.data() && thumb->data) {
-        std::memcpy(result.data(), thumb->data, data_size);
+      if (result.data()) {
+        copyPackedRows(result, thumb->data);
       } else {
-        error_ = "Failed to copy thumbnail data";
+        fail("Failed to copy thumbnail data");
       }
     } else {
-      error_ = "Unsupported thumbnail format";
+      fail("Unsupported thumbnail format");
     }
 
     LibRaw::dcraw_clear_mem(thumb);
 
     // 如果缩略图获取失败，使用小尺寸预览
     if (!result.isValid()) {
-      return decodePreview(480, 480);
+      return decodePreview(480, 480, token);
     }
 
     return result;
   }
 
-  RawData getThumbnailData() {
+  RawData getThumbnailData(const CancellationToken &token) {
+    CancelScope scope(*this, token);
     if (!open_) {
-      error_ = "No file opened";
+      fail("No file opened");
+      return RawData();
+    }
+
+    CallScope call(*this, "getThumbnailData");
+    if (cancelled()) {
       return RawData();
     }
+    if (smart_preview_) {
+      fail("Embedded thumbnail is not available in a smart preview");
+      return RawData();
+    }
+    auto timer = stats_.stage(DecodeStage::Thumbnail);
 
     int ret = libraw_->unpack_thumb();
     if (ret != LIBRAW_SUCCESS) {
-      error_ = "Unpack thumbnail failed";
+      fail("Unpack thumbnail failed");
       return RawData();
     }
 
     libraw_processed_image_t *thumb = libraw_->dcraw_make_mem_thumb(&ret);
     if (!thumb) {
-      error_ = "Failed to create thumbnail";
+      fail("Failed to create thumbnail");
       return RawData();
     }
 
@@ -286,35 +433,769 @@ public:
     } else {
       // 不是 JPEG 格式，返回空
       LibRaw::dcraw_clear_mem(thumb);
-      error_ = "Thumbnail is not in JPEG format";
+      fail("Thumbnail is not in JPEG format");
       return RawData();
     }
   }
 
+  ImageStatistics computeRawStatistics(const StatisticsOptions &options, const CancellationToken &token) {
+    CancelScope scope(*this, token);
+    ImageStatistics result;
+    if (!open_) {
+      fail("No file opened");
+      return result;
+    }
+
+    CallScope call(*this, "computeRawStatistics");
+    if (smart_preview_) {
+      fail("Raw data is not available in a smart preview");
+      return result;
+    }
+    if (cancelled()) {
+      return result;
+    }
+    MemoryScope memory(*this);
+    if (!acquireMemory("computeRawStatistics", retainedBytes() + unpackBytes()) || !ensureUnpacked()) {
+      return result;
+    }
+
+    libraw_rawdata_t &raw = libraw_->imgdata.rawdata;
+    const int top = raw.sizes.top_margin;
+    const int left = raw.sizes.left_margin;
+    const int width = raw.sizes.width;
+    const int height = raw.sizes.height;
+    const size_t pitch = raw.sizes.raw_pitch / sizeof(uint16_t); // 以 uint16 为单位
+
+    // 每个颜色（CfaPattern 的 0..3）的黑电平和归一化系数
+    float black[4];
+    float inv_range[4];
+    for (int c = 0; c < 4; ++c) {
+      black[c] = static_cast<float>(raw.color.black + raw.color.cblack[CfaPattern::blackChannel(c)]);
+      float range = static_cast<float>(raw.color.maximum) - black[c];
+      inv_range[c] = range > 0.0f ? 1.0f / range : 0.0f;
+    }
+
+    const uint16_t *bayer = raw.raw_image;
+    const uint16_t(*color3)[3] = raw.color3_image;
+    const uint16_t(*color4)[4] = raw.color4_image;
+    if (!bayer && !color3 && !color4) {
+      fail("Unsupported raw data layout");
+      return result;
+    }
+
+    // 单色传感器的采样计入亮度通道（CfaPattern::kGrey == ImageStatistics::kLuma）
+    static_assert(CfaPattern::kGrey == ImageStatistics::kLuma, "grey samples go to the luma channel");
+    const CfaPattern pattern(*libraw_);
+
+    StatisticsAccumulator total(options);
+    RowBandCancellation cancel(token_);
+
+#pragma omp parallel
+    {
+      StatisticsAccumulator local(options);
+
+#pragma omp for schedule(static)
+      for (int y = 0; y < height; ++y) {
+        if (cancel.skip(y)) {
+          continue;
+        }
+
+        size_t offset = static_cast<size_t>(top + y) * pitch;
+        if (bayer) {
+          const uint16_t *row = bayer + offset + left;
+          const int8_t *colors = pattern.row(y);
+          for (int x = 0; x < width; ++x) {
+            int c = colors ? colors[x % CfaPattern::kPeriod] : pattern.at(y, x);
+            local.addSample(c, local.bin((row[x] - black[c]) * inv_range[c]));
+          }
+        } else {
+          // color3/color4 图像的 raw_pitch 以像素结构为单位计算字节
+          for (int x = 0; x < width; ++x) {
+            const uint16_t *px = color3 ? color3[(top + y) * (raw.sizes.raw_pitch / 6) + left + x]
+                                        : color4[(top + y) * (raw.sizes.raw_pitch / 8) + left + x];
+            for (int c = 0; c < 3; ++c) {
+              local.addSample(c, local.bin((px[c] - black[c]) * inv_range[c]));
+            }
+          }
+        }
+      }
+
+#pragma omp critical(pixraw_raw_statistics_merge)
+      total.merge(local);
+    }
+
+    if (cancel.stopped() && cancelled()) {
+      return result;
+    }
+
+    total.addPixels(static_cast<uint64_t>(width) * height);
+    total.finish(result);
+    return result;
+  }
+
+  ImageSignature computeSignature(const CancellationToken &token) {
+    CancelScope scope(*this, token);
+    if (!open_) {
+      fail("No file opened");
+      return ImageSignature();
+    }
+
+    CallScope call(*this, "computeSignature");
+    if (cancelled()) {
+      return ImageSignature();
+    }
+
+    MemoryScope memory(*this);
+    ImageSignature result;
+    if (smart_preview_) {
+      if (!(image_decoded_ && cached_image_.isValid()) &&
+          (!acquireMemory("computeSignature", retainedBytes() + smartPreviewBytes()) || !decodeSmartPreview())) {
+        return result;
+      }
+      auto timer = stats_.stage(DecodeStage::Signature);
+      const HalfPlanarImage &image = cached_image_;
+      result = ImageSignature::compute(
+          image.width(), image.height(),
+          [&image](int y, float *r, float *g, float *b) {
+            image.loadRow(0, y, r);
+            image.loadRow(1, y, g);
+            image.loadRow(2, y, b);
+          },
+          true, SignatureSource::SmartPreview, token_);
+    } else {
+      // 嵌入的位图缩略图足够大时直接使用；JPEG 缩略图需要解码器，改用 CFA
+      result = thumbnailSignature();
+      if (!result.isValid()) {
+        if (cancelled() || !acquireMemory("computeSignature", retainedBytes() + unpackBytes()) ||
+            !ensureUnpacked()) {
+          return result;
+        }
+        result = cfaSignature();
+      }
+    }
+
+    if (!result.isValid() && !cancelled() && status_ == DecodeStatus::Success) {
+      fail("Failed to compute image signature");
+    }
+    return result;
+  }
+
   std::string getLastError() const { return error_; }
 
+  DecodeStatus getLastStatus() const { return status_; }
+
   bool isOpen() const { return open_; }
 
   void close() {
     if (open_) {
       libraw_->recycle();
+      stream_.reset(); // LibRaw 不拥有外部数据流，recycle 之后释放
+      smart_preview_.reset();
+      prefetched_ = PrefetchedFile(); // LibRaw 已不再引用，归还缓冲区
+      buffer_bytes_ = 0;
       open_ = false;
+      unpacked_ = false;
       image_decoded_ = false;
-      cached_image_ = RawImage(); // 释放缓存
+      cached_half_size_ = false;
+      cached_image_ = HalfPlanarImage(); // 释放缓存
     }
+    memory_.release();
   }
 
   void setAdjustments(const RawAdjustments &adjustments) { adjustments_ = adjustments; }
 
   RawAdjustments getAdjustments() const { return adjustments_; }
 
+  void setOutputColorSpace(OutputColorSpace space) { output_space_ = space; }
+
+  OutputColorSpace getOutputColorSpace() const { return output_space_; }
+
+  void setInstrumentationEnabled(bool enabled) { stats_.setEnabled(enabled); }
+
+  bool isInstrumentationEnabled() const { return stats_.isEnabled(); }
+
+  void setParallelUnpack(bool enabled) { libraw_->setParallelUnpack(enabled); }
+
+  bool isParallelUnpack() const { return libraw_->isParallelUnpack(); }
+
+  DecodeStats getLastStats() const { return stats_.last(); }
+
+  void setStatisticsOptions(const StatisticsOptions &options) { statistics_options_ = options; }
+
+  StatisticsOptions getStatisticsOptions() const { return statistics_options_; }
+
+  ImageStatistics getLastStatistics() const { return last_statistics_; }
+
+  bool writeSmartPreview(const std::string &filepath, const SmartPreviewOptions &options,
+                         const CancellationToken &token) {
+    CancelScope scope(*this, token);
+    if (!open_) {
+      fail("No file opened");
+      return false;
+    }
+    if (options.long_edge <= 0) {
+      fail("Invalid smart preview size");
+      return false;
+    }
+
+    CallScope call(*this, "writeSmartPreview");
+    if (cancelled()) {
+      return false;
+    }
+
+    MemoryScope memory(*this);
+    HalfPlanarImage proxy;
+    CameraColor camera;
+    if (!buildSmartPreview(options.long_edge, proxy, camera)) {
+      return false;
+    }
+
+    auto timer = stats_.stage(DecodeStage::Output);
+    std::string error;
+    if (!SmartPreview::write(filepath, proxy, getMetadata(), camera, options.lossy, &error, token_)) {
+      if (!cancelled()) {
+        fail(error);
+      }
+      return false;
+    }
+    return true;
+  }
+
+  bool isSmartPreview() const { return smart_preview_ != nullptr; }
+
 private:
-  std::unique_ptr<LibRaw> libraw_;
+  void fail(const std::string &message) {
+    error_ = message;
+    status_ = DecodeStatus::Failed;
+  }
+
+  // 当前调用已取消或超时时记录状态并返回 true
+  bool cancelled() {
+    DecodeStatus status = token_.status();
+    if (status == DecodeStatus::Success) {
+      return false;
+    }
+    status_ = status;
+    error_ = (status == DecodeStatus::DeadlineExceeded) ? "Deadline exceeded" : "Cancelled";
+    return true;
+  }
+
+  // LibRaw 在回调取消后会 recycle()，需要重新打开文件
+  void onLibRawCancelled() {
+    close();
+    if (!cancelled()) {
+      status_ = DecodeStatus::Cancelled;
+      error_ = "Cancelled";
+    }
+  }
+
+  static int progressCallback(void *data, enum LibRaw_progress, int, int) {
+    const Impl *impl = static_cast<const Impl *>(data);
+    return impl->token_.isCancelled() ? 1 : 0;
+  }
+
+  // 一次公开解码调用的取消范围（可嵌套，只有最外层安装令牌）
+  // cancel() 通过 setCancelFlag() 转发给 LibRaw，解码器在逐行循环中检查；
+  // 截止时间在进度回调和本库的行带循环中轮询
+  class CancelScope {
+  public:
+    CancelScope(Impl &impl, const CancellationToken &token) : impl_(impl) {
+      if (impl_.cancel_depth_++ > 0) {
+        return;
+      }
+      impl_.status_ = DecodeStatus::Success;
+      impl_.token_ = token;
+      impl_.libraw_->clearCancelFlag();
+      LibRaw *libraw = impl_.libraw_.get();
+      listener_ = token.addListener([libraw] { libraw->setCancelFlag(); });
+    }
+    ~CancelScope() {
+      if (--impl_.cancel_depth_ > 0) {
+        return;
+      }
+      impl_.token_.removeListener(listener_);
+      impl_.token_ = CancellationToken();
+    }
+    CancelScope(const CancelScope &) = delete;
+    CancelScope &operator=(const CancelScope &) = delete;
+
+  private:
+    Impl &impl_;
+    int listener_ = -1;
+  };
+
+  // 解包 RAW 数据（每次打开只执行一次）
+  bool ensureUnpacked() {
+    if (unpacked_) {
+      return true;
+    }
+
+    int ret;
+    {
+      auto timer = stats_.stage(DecodeStage::Unpack);
+      ret = libraw_->unpack();
+    }
+    if (ret == LIBRAW_CANCELLED_BY_CALLBACK) {
+      onLibRawCancelled();
+      return false;
+    }
+    if (ret != LIBRAW_SUCCESS) {
+      fail("Unpack failed: " + std::string(libraw_strerror(ret)));
+      return false;
+    }
+    stats_.addAllocated(static_cast<uint64_t>(libraw_->imgdata.rawdata.sizes.raw_pitch) *
+                        libraw_->imgdata.rawdata.sizes.raw_height);
+    unpacked_ = true;
+    return true;
+  }
+
+  // 一次公开调用的统计范围（可嵌套，只有最外层生成统计）
+  class CallScope {
+  public:
+    CallScope(const Impl &impl, const char *operation) : impl_(impl) {
+      impl_.stats_.begin(operation, impl_.bytesRead());
+    }
+    ~CallScope() { impl_.stats_.end(impl_.bytesRead()); }
+
+  private:
+    const Impl &impl_;
+  };
+
+  // 文件按数据流实际读取的字节数计；从内存打开时整个缓冲区计入打开调用
+  uint64_t bytesRead() const { return stream_ ? stream_->bytes() : buffer_bytes_; }
+
+  bool openSmartPreview(std::unique_ptr<SmartPreview> preview, const std::string &error) {
+    if (!preview) {
+      fail("Failed to open smart preview: " + error);
+      return false;
+    }
+
+    smart_preview_ = std::move(preview);
+    open_ = true;
+    error_.clear();
+    status_ = DecodeStatus::Success;
+    return true;
+  }
+
+  // 嵌入的位图缩略图（长边不小于 640）计算签名，否则返回无效签名
+  ImageSignature thumbnailSignature() {
+    const libraw_thumbnail_t &info = libraw_->imgdata.thumbnail;
+    if (info.tformat != LIBRAW_THUMBNAIL_BITMAP || std::max(info.twidth, info.theight) < 640) {
+      return ImageSignature();
+    }
+
+    libraw_processed_image_t *thumb = nullptr;
+    {
+      auto timer = stats_.stage(DecodeStage::Thumbnail);
+      int ret = libraw_->unpack_thumb();
+      if (ret == LIBRAW_SUCCESS) {
+        thumb = libraw_->dcraw_make_mem_thumb(&ret);
+      }
+    }
+    if (!thumb) {
+      return ImageSignature();
+    }
+
+    ImageSignature result;
+    if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->colors == 3 && thumb->bits == 8) {
+      auto timer = stats_.stage(DecodeStage::Signature);
+      RawImage image = RawImage::wrap(thumb->data, thumb->width, thumb->height, thumb->width * 3, PixelFormat::RGB888);
+      result = ImageSignature::fromImage(image, token_);
+      result.source = result.isValid() ? SignatureSource::Thumbnail : SignatureSource::None;
+    }
+    LibRaw::dcraw_clear_mem(thumb);
+    return result;
+  }
+
+  // 2x2 合并的 CFA（每个 Bayer 单元一个 RGB 像素），黑电平归一化并乘以相机白平衡
+  ImageSignature cfaSignature() {
+    auto timer = stats_.stage(DecodeStage::Signature);
+
+    libraw_rawdata_t &raw = libraw_->imgdata.rawdata;
+    const int top = raw.sizes.top_margin;
+    const int left = raw.sizes.left_margin;
+    const int width = raw.sizes.width / 2;
+    const int height = raw.sizes.height / 2;
+    const size_t pitch = raw.sizes.raw_pitch / sizeof(uint16_t);
+
+    const float *mul = libraw_->imgdata.color.cam_mul;
+    if (!(mul[0] > 0.0f && mul[1] > 0.0f && mul[2] > 0.0f)) {
+      mul = libraw_->imgdata.color.pre_mul;
+    }
+    // 每个颜色（CfaPattern 的 0..3，单色为 kGrey）的黑电平和归一化系数
+    float scale[4];
+    float black[4];
+    for (int c = 0; c < 4; ++c) {
+      black[c] = static_cast<float>(raw.color.black + raw.color.cblack[CfaPattern::blackChannel(c)]);
+      float range = static_cast<float>(raw.color.maximum) - black[c];
+      float wb = (mul[1] > 0.0f && mul[c < 3 ? c : 1] > 0.0f) ? mul[c < 3 ? c : 1] / mul[1] : 1.0f;
+      scale[c] = range > 0.0f ? wb / range : 0.0f;
+    }
+
+    const uint16_t *bayer = raw.raw_image;
+    const uint16_t(*color3)[3] = raw.color3_image;
+    const uint16_t(*color4)[4] = raw.color4_image;
+    if (!bayer && !color3 && !color4) {
+      return ImageSignature();
+    }
+
+    // CFA 颜色排列与 computeRawStatistics 相同
+    const CfaPattern pattern(*libraw_);
+
+    auto rows = [&](int y, float *r, float *g, float *b) {
+      const int sy = 2 * y;
+      if (bayer) {
+        const uint16_t *row[2] = {bayer + static_cast<size_t>(top + sy) * pitch + left,
+                                  bayer + static_cast<size_t>(top + sy + 1) * pitch + left};
+        const int8_t *colors[2] = {pattern.row(sy), pattern.row(sy + 1)};
+        for (int x = 0; x < width; ++x) {
+          // 每个 2x2 单元按颜色求平均；X-Trans 单元可能缺少红或蓝，用绿色代替；单色单元 r = g = b
+          float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+          int count[4] = {0, 0, 0, 0};
+          for (int dy = 0; dy < 2; ++dy) {
+            for (int dx = 0; dx < 2; ++dx) {
+              const int sx = 2 * x + dx;
+              const int c = colors[dy] ? colors[dy][sx % CfaPattern::kPeriod] : pattern.at(sy + dy, sx);
+              sum[c] += (row[dy][sx] - black[c]) * scale[c];
+              ++count[c];
+            }
+          }
+          if (count[CfaPattern::kGrey]) {
+            r[x] = g[x] = b[x] = sum[CfaPattern::kGrey] / count[CfaPattern::kGrey];
+            continue;
+          }
+          const float green = count[1] ? sum[1] / count[1] : 0.0f;
+          r[x] = count[0] ? sum[0] / count[0] : green;
+          g[x] = green;
+          b[x] = count[2] ? sum[2] / count[2] : green;
+        }
+      } else {
+        for (int x = 0; x < width; ++x) {
+          float sum[3] = {0.0f, 0.0f, 0.0f};
+          for (int dy = 0; dy < 2; ++dy) {
+            for (int dx = 0; dx < 2; ++dx) {
+              const size_t index = static_cast<size_t>(top + sy + dy) * (raw.sizes.raw_pitch / (color3 ? 6 : 8)) +
+                                   left + 2 * x + dx;
+              const uint16_t *px = color3 ? color3[index] : color4[index];
+              for (int c = 0; c < 3; ++c) {
+                sum[c] += (px[c] - black[c]) * scale[c];
+              }
+            }
+          }
+          r[x] = sum[0] * 0.25f;
+          g[x] = sum[1] * 0.25f;
+          b[x] = sum[2] * 0.25f;
+        }
+      }
+    };
+
+    return ImageSignature::compute(width, height, rows, true, SignatureSource::RawCfa, token_);
+  }
+
+  // 输出尺寸上限相对原始尺寸的缩放比例（不放大；任一上限为 0 时按全尺寸）
+  // 只用于决定 half_size，智能预览总是解码整幅代理图像
+  double previewScale(int max_width, int max_height) const {
+    if (max_width <= 0 || max_height <= 0 || smart_preview_) {
+      return 1.0;
+    }
+    const libraw_image_sizes_t &sizes = libraw_->imgdata.sizes;
+    if (sizes.width == 0 || sizes.height == 0) {
+      return 1.0;
+    }
+    double scale_width = static_cast<double>(max_width) / sizes.width;
+    double scale_height = static_cast<double>(max_height) / sizes.height;
+    return std::min(1.0, std::min(scale_width, scale_height));
+  }
+
+  // 缓存能否满足所需档位：全尺寸缓存也用于 half_size 请求，half_size 缓存只用于 half_size 请求
+  bool hasCachedImage(bool half_size) const {
+    return image_decoded_ && cached_image_.isValid() && (smart_preview_ || half_size || !cached_half_size_);
+  }
+
+  // 确保线性图像缓存可用：缓存满足所需档位时直接返回；智能预览解码代理图像；
+  // 否则解包并 dcraw_process()（替换档位不够的缓存）
+  bool ensureDecoded(bool half_size) {
+    if (hasCachedImage(half_size)) {
+      return true;
+    }
+    if (smart_preview_) {
+      return decodeSmartPreview();
+    }
+
+    if (!ensureUnpacked() || cancelled()) {
+      return false;
+    }
+    image_decoded_ = false;
+    cached_image_ = HalfPlanarImage(); // 先释放 half_size 缓存，与预算估算一致
+    std::string error;
+    int ret = decodeLinear(*libraw_, half_size, stats_, cached_image_, camera_color_, error);
+    if (ret == LIBRAW_CANCELLED_BY_CALLBACK) {
+      onLibRawCancelled();
+      return false;
+    }
+    if (ret != LIBRAW_SUCCESS) {
+      fail(error);
+      return false;
+    }
+    image_decoded_ = true;
+    cached_half_size_ = half_size;
+    return true;
+  }
+
+  // 按元数据尺寸和档位估算本次调用的峰值内存，向进程级预算申请；
+  // 预算不足而 half_size 放得下时改用 half_size
+  bool reserveMemory(const char *operation, bool &half_size) {
+    uint64_t bytes = 0;
+    uint64_t fallback = 0;
+    if (hasCachedImage(half_size)) {
+      bytes = retainedBytes() + MemoryBudget::estimateRender(cached_image_.width(), cached_image_.height());
+    } else if (smart_preview_) {
+      bytes = smartPreviewBytes() +
+              MemoryBudget::estimateRender(smart_preview_->width(), smart_preview_->height());
+    } else {
+      const RawMetadata metadata = readMetadata(*libraw_);
+      bytes = MemoryBudget::estimateDecode(metadata, half_size).peak();
+      if (!half_size) {
+        // 已有 half_size 缓存时降级直接使用缓存
+        fallback = hasCachedImage(true)
+                       ? retainedBytes() + MemoryBudget::estimateRender(cached_image_.width(), cached_image_.height())
+                       : MemoryBudget::estimateDecode(metadata, true).peak();
+      }
+    }
+
+    if (!acquireMemory(operation, bytes, fallback)) {
+      return false;
+    }
+    if (memory_.downgraded()) {
+      half_size = true;
+    }
+    return true;
+  }
+
+  // 向进程级预算申请本次调用的峰值内存（bytes 含实例已保留的缓存），排队期间可取消
+  bool acquireMemory(const char *operation, uint64_t bytes, uint64_t fallback = 0) {
+    if (!memory_.acquire(operation, bytes, fallback, token_)) {
+      cancelled();
+      return false;
+    }
+    return true;
+  }
+
+  // 解包新增的 RAW 数据（已解包时为 0）
+  uint64_t unpackBytes() const {
+    return unpacked_ ? 0 : MemoryBudget::estimateDecode(readMetadata(*libraw_), false).raw_bytes;
+  }
+
+  // 智能预览解码新增的线性缓存（已解码时为 0）
+  uint64_t smartPreviewBytes() const {
+    if (image_decoded_ && cached_image_.isValid()) {
+      return 0;
+    }
+    return static_cast<uint64_t>(smart_preview_->width()) * smart_preview_->height() * 3 * sizeof(uint16_t);
+  }
+
+  // 调用结束后实例保留的大缓冲区：RAW 数据和线性缓存（LibRaw 的工作图像在 decodeLinear() 中已释放）
+  uint64_t retainedBytes() const {
+    if (!open_) {
+      return 0;
+    }
+    uint64_t bytes = cached_image_.byteSize();
+    if (unpacked_) {
+      const libraw_image_sizes_t &sizes = libraw_->imgdata.rawdata.sizes;
+      bytes += static_cast<uint64_t>(sizes.raw_pitch) * sizes.raw_height;
+    }
+    return bytes;
+  }
+
+  // 调用结束时把预留改为实际保留的字节数
+  class MemoryScope {
+  public:
+    explicit MemoryScope(Impl &impl) : impl_(impl) {}
+    ~MemoryScope() { impl_.memory_.settle(impl_.retainedBytes()); }
+    MemoryScope(const MemoryScope &) = delete;
+    MemoryScope &operator=(const MemoryScope &) = delete;
+
+  private:
+    Impl &impl_;
+  };
+
+  // 将智能预览解码为缓存的线性图像
+  bool decodeSmartPreview() {
+    std::string error;
+    {
+      auto timer = stats_.stage(DecodeStage::Convert);
+      cached_image_ = smart_preview_->decode(token_, &error);
+    }
+    if (!cached_image_.isValid()) {
+      if (!cancelled()) {
+        fail(error);
+      }
+      return false;
+    }
+    stats_.addAllocated(cached_image_.byteSize());
+    camera_color_ = smart_preview_->camera();
+    image_decoded_ = true;
+    return true;
+  }
+
+  // 生成长边不超过 long_edge 的线性图像：已有足够大的缓存时直接缩小，
+  // 否则重新 dcraw_process()（长边足够时使用 half_size）
+  bool buildSmartPreview(int long_edge, HalfPlanarImage &proxy, CameraColor &camera) {
+    // 浮点源图像与缩小结果按一次渲染估算；重新解码的结果不进入缓存，只在调用期间存在
+    const libraw_image_sizes_t &sizes = libraw_->imgdata.sizes;
+    bool half_size = !smart_preview_ && std::max(sizes.width, sizes.height) / 2 >= long_edge;
+    const bool from_cache =
+        smart_preview_ || (image_decoded_ && cached_image_.isValid() &&
+                           std::max(cached_image_.width(), cached_image_.height()) >= long_edge);
+    uint64_t bytes = retainedBytes();
+    uint64_t fallback = 0;
+    if (smart_preview_) {
+      bytes += smartPreviewBytes() + MemoryBudget::estimateRender(smart_preview_->width(), smart_preview_->height());
+    } else if (from_cache) {
+      bytes += MemoryBudget::estimateRender(cached_image_.width(), cached_image_.height());
+    } else {
+      const RawMetadata metadata = readMetadata(*libraw_);
+      auto decode = [&](bool half) {
+        const MemoryEstimate estimate = MemoryBudget::estimateDecode(metadata, half);
+        return bytes + unpackBytes() + estimate.peak() - estimate.raw_bytes;
+      };
+      fallback = half_size ? 0 : decode(true);
+      bytes = decode(half_size);
+    }
+    if (!acquireMemory("writeSmartPreview", bytes, fallback)) {
+      return false;
+    }
+    if (memory_.downgraded()) {
+      half_size = true;
+    }
+
+    if (smart_preview_ && !(image_decoded_ && cached_image_.isValid()) && !decodeSmartPreview()) {
+      return false;
+    }
+
+    PlanarImage source;
+    if (from_cache) {
+      auto timer = stats_.stage(DecodeStage::Convert);
+      source = cached_image_.toPlanar();
+      camera = camera_color_;
+    } else {
+      if (!ensureUnpacked() || cancelled()) {
+        return false;
+      }
+      std::string error;
+      int ret = decodeLinear(*libraw_, half_size, stats_, source, camera, error);
+      if (ret == LIBRAW_CANCELLED_BY_CALLBACK) {
+        onLibRawCancelled();
+        return false;
+      }
+      if (ret != LIBRAW_SUCCESS) {
+        fail(error);
+        return false;
+      }
+    }
+    if (!source.isValid() || cancelled()) {
+      return false;
+    }
+
+    auto timer = stats_.stage(DecodeStage::Convert);
+    const int width = source.width();
+    const int height = source.height();
+    const double scale = std::min(1.0, static_cast<double>(long_edge) / std::max(width, height));
+    if (scale < 1.0) {
+      PlanarImage resized(std::max(1, static_cast<int>(width * scale + 0.5)),
+                          std::max(1, static_cast<int>(height * scale + 0.5)));
+      source.resampleInto(resized, 0, 0, width, height, token_);
+      if (cancelled()) {
+        return false;
+      }
+      source = std::move(resized);
+    }
+    proxy = HalfPlanarImage::fromPlanar(source);
+    if (!proxy.isValid()) {
+      fail("Failed to allocate smart preview");
+      return false;
+    }
+    return true;
+  }
+
+  // 对缓存的线性图像应用色彩变换和当前调整参数（输出前的公共部分）
+  bool renderWorking(PlanarImage &working) {
+    if (!cached_image_.isValid()) {
+      return false;
+    }
+
+    // 曝光/白平衡/色温/色调在线性相机空间处理，与相机矩阵、输出色彩空间合并到同一张 LUT
+    ColorSettings color = ColorSettings::sceneReferred(adjustments_, output_space_);
+    working = PlanarImage(cached_image_.width(), cached_image_.height());
+    stats_.addAllocated(working.byteSize());
+    {
+      auto timer = stats_.stage(DecodeStage::Color);
+      std::shared_ptr<const ColorLut3D> lut = ColorLut3D::cached(camera_color_, color);
+      lut->apply(cached_image_, working, token_);
+    }
+    if (cancelled()) {
+      return false;
+    }
+
+    RawAdjustments display = adjustments_.displayReferred();
+    if (display.hasAdjustments()) {
+      auto timer = stats_.stage(DecodeStage::Adjust);
+      ImageAdjuster::applyAdjustments(working, display, token_);
+    }
+    return !cancelled();
+  }
+
+  // 对缓存的线性图像应用色彩变换和当前调整参数，并在输出边界交错为 RGB888
+  // 调整参数改变时只重跑这一步，不再 dcraw_process()
+  RawImage renderCached() {
+    PlanarImage working;
+    if (!renderWorking(working)) {
+      return RawImage();
+    }
+
+    // 统计在最终写出时一并计算
+    auto timer = stats_.stage(DecodeStage::Output);
+    last_statistics_ = ImageStatistics();
+    RawImage result = working.toInterleaved(PixelFormat::RGB888, &last_statistics_, statistics_options_, token_);
+    if (!result.isValid()) {
+      if (!cancelled()) {
+        fail("Failed to create output image");
+      }
+      return RawImage();
+    }
+    stats_.addAllocated(result.byteSize());
+    return result;
+  }
+
+  // 将紧密排列的 LibRaw 像素数据逐行拷贝到按 stride 对齐的图像
+  static void copyPackedRows(RawImage &dst, const uint8_t *src) {
+    int row_bytes = dst.rowBytes();
+    for (int y = 0; y < dst.height(); ++y) {
+      std::memcpy(dst.row(y), src + static_cast<size_t>(y) * row_bytes, row_bytes);
+    }
+  }
+
+  std::unique_ptr<ParallelLibRaw> libraw_;
+  std::unique_ptr<CountingFileDatastream> stream_; // 启用插桩时使用的数据流
+  std::unique_ptr<SmartPreview> smart_preview_;    // 打开的是智能预览时不使用 LibRaw
+  PrefetchedFile prefetched_;                      // open(PrefetchedFile) 接管的缓冲区
+  uint64_t buffer_bytes_ = 0;                      // 从内存打开的缓冲区大小
+  mutable StatsRecorder stats_;
   bool open_;
   std::string error_;
   RawAdjustments adjustments_;
-  RawImage cached_image_;      // 缓存已解码的原始图像
+  HalfPlanarImage cached_image_; // 缓存已解码的原始图像（场景线性相机 RGB，平面半精度）
+  CameraColor camera_color_;   // 缓存图像对应的相机矩阵
+  OutputColorSpace output_space_ = OutputColorSpace::sRGB;
   bool image_decoded_ = false; // 是否已经解码过
+  bool cached_half_size_ = false; // 缓存是否为 half_size 解码（智能预览总是整幅代理图像）
+  bool unpacked_ = false;      // 是否已经解包
+  DecodeStatus status_ = DecodeStatus::Success; // 最近一次调用的状态
+  CancellationToken token_;    // 当前调用的取消令牌（调用之外为空令牌）
+  int cancel_depth_ = 0;
+  StatisticsOptions statistics_options_;
+  mutable ImageStatistics last_statistics_; // 最近一次输出图像的统计
+  MemoryReservation memory_;   // 在进程级内存预算中的预留
 };
 
 // === PixRaw 实现 ===
@@ -331,23 +1212,36 @@ bool PixRaw::open(const std::string &filepath) { return impl_->open(filepath); }
 
 bool PixRaw::open(const std::wstring &filepath) { return impl_->open(filepath); }
 
+bool PixRaw::openBuffer(const void *data, size_t size) { return impl_->openBuffer(data, size); }
+
+bool PixRaw::open(PrefetchedFile file) { return impl_->open(std::move(file)); }
+
 RawMetadata PixRaw::getMetadata() const { return impl_->getMetadata(); }
 
-RawImage PixRaw::decodePreview(int max_width, int max_height) { return impl_->decodePreview(max_width, max_height); }
+RawImage PixRaw::decodePreview(int max_width, int max_height, const CancellationToken &token) {
+  return impl_->decodePreview(max_width, max_height, token);
+}
+
+std::vector<RawImage> PixRaw::decodeRenditions(const std::vector<RenditionSpec> &specs,
+                                               const CancellationToken &token) {
+  return impl_->decodeRenditions(specs, token);
+}
 
-RawImage PixRaw::decodeFull() { return impl_->decodeFull(); }
+RawImage PixRaw::decodeFull(const CancellationToken &token) { return impl_->decodeFull(token); }
 
-RawImage PixRaw::decodeQuickPreview() { return impl_->decodeQuickPreview(); }
+RawImage PixRaw::decodeQuickPreview(const CancellationToken &token) { return impl_->decodeQuickPreview(token); }
 
-RawImage PixRaw::decodeMediumPreview() { return impl_->decodeMediumPreview(); }
+RawImage PixRaw::decodeMediumPreview(const CancellationToken &token) { return impl_->decodeMediumPreview(token); }
 
-RawImage PixRaw::getThumbnail() { return impl_->getThumbnail(); }
+RawImage PixRaw::getThumbnail(const CancellationToken &token) { return impl_->getThumbnail(token); }
 
 std::string PixRaw::getLastError() const { return impl_->getLastError(); }
 
+DecodeStatus PixRaw::getLastStatus() const { return impl_->getLastStatus(); }
+
 bool PixRaw::isOpen() const { return impl_->isOpen(); }
 
-RawData PixRaw::getThumbnailData() { return impl_->getThumbnailData(); }
+RawData PixRaw::getThumbnailData(const CancellationToken &token) { return impl_->getThumbnailData(token); }
 
 void PixRaw::close() { impl_->close(); }
 
@@ -355,4 +1249,37 @@ void PixRaw::setAdjustments(const RawAdjustments &adjustments) { impl_->setAdjus
 
 RawAdjustments PixRaw::getAdjustments() const { return impl_->getAdjustments(); }
 
+void PixRaw::setOutputColorSpace(OutputColorSpace space) { impl_->setOutputColorSpace(space); }
+
+OutputColorSpace PixRaw::getOutputColorSpace() const { return impl_->getOutputColorSpace(); }
+
+void PixRaw::setInstrumentationEnabled(bool enabled) { impl_->setInstrumentationEnabled(enabled); }
+
+bool PixRaw::isInstrumentationEnabled() const { return impl_->isInstrumentationEnabled(); }
+
+void PixRaw::setParallelUnpack(bool enabled) { impl_->setParallelUnpack(enabled); }
+
+bool PixRaw::isParallelUnpack() const { return impl_->isParallelUnpack(); }
+
+DecodeStats PixRaw::getLastStats() const { return impl_->getLastStats(); }
+
+void PixRaw::setStatisticsOptions(const StatisticsOptions &options) { impl_->setStatisticsOptions(options); }
+
+StatisticsOptions PixRaw::getStatisticsOptions() const { return impl_->getStatisticsOptions(); }
+
+ImageStatistics PixRaw::getLastStatistics() const { return impl_->getLastStatistics(); }
+
+ImageStatistics PixRaw::computeRawStatistics(const StatisticsOptions &options, const CancellationToken &token) {
+  return impl_->computeRawStatistics(options, token);
+}
+
+ImageSignature PixRaw::computeSignature(const CancellationToken &token) { return impl_->computeSignature(token); }
+
+bool PixRaw::writeSmartPreview(const std::string &filepath, const SmartPreviewOptions &options,
+                               const CancellationToken &token) {
+  return impl_->writeSmartPreview(filepath, options, token);
+}
+
+bool PixRaw::isSmartPreview() const { return impl_->isSmartPreview(); }
+
 } // namespace PixRaw
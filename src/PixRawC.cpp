@@ -0,0 +1,696 @@
+#include "PixRawC.h"
+#include "Cancellation.h"
+#include "PixRaw.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using PixRaw::CancellationToken;
+using PixRaw::DecodeStatus;
+using PixRaw::RawImage;
+
+// === 句柄定义 ===
+
+struct pixraw_decoder {
+    PixRaw::PixRaw processor;
+    std::string error;
+};
+
+struct pixraw_image {
+    std::atomic<int> refs{1};
+    RawImage image;
+};
+
+struct pixraw_blob {
+    PixRaw::RawData data;
+};
+
+namespace {
+
+void copyString(char* dst, size_t capacity, const std::string& src) {
+    size_t n = std::min(src.size(), capacity - 1);
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+pixraw_status toStatus(DecodeStatus status) {
+    switch (status) {
+        case DecodeStatus::Success:
+            return PIXRAW_OK;
+        case DecodeStatus::Cancelled:
+            return PIXRAW_CANCELLED;
+        case DecodeStatus::DeadlineExceeded:
+            return PIXRAW_DEADLINE_EXCEEDED;
+        case DecodeStatus::Failed:
+            break;
+    }
+    return PIXRAW_ERROR;
+}
+
+// 按 struct_size 读取调用者的参数，缺失字段保持默认值
+pixraw_decode_options resolveOptions(const pixraw_decode_options* options) {
+    pixraw_decode_options resolved;
+    pixraw_decode_options_init(&resolved);
+    if (options && options->struct_size > sizeof(uint32_t)) {
+        size_t n = std::min<size_t>(options->struct_size, sizeof(resolved));
+        std::memcpy(reinterpret_cast<uint8_t*>(&resolved) + sizeof(uint32_t),
+                    reinterpret_cast<const uint8_t*>(options) + sizeof(uint32_t), n - sizeof(uint32_t));
+        resolved.struct_size = sizeof(resolved);
+    }
+    return resolved;
+}
+
+CancellationToken tokenFor(const pixraw_decode_options& options) {
+    if (options.timeout_ms > 0) {
+        return CancellationToken::withTimeout(std::chrono::milliseconds(options.timeout_ms));
+    }
+    return CancellationToken::create();
+}
+
+void copySignature(const PixRaw::ImageSignature& signature, pixraw_signature* out) {
+    static_assert(sizeof(out->color) == PixRaw::ImageSignature::kColorBytes, "color signature size");
+    std::memset(out, 0, sizeof(*out));
+    out->perceptual_hash = signature.perceptual_hash;
+    std::memcpy(out->color, signature.color, sizeof(out->color));
+    out->sharpness = signature.sharpness;
+    out->sharpness_peak = signature.sharpness_peak;
+    out->analysis_width = signature.analysis_width;
+    out->analysis_height = signature.analysis_height;
+    out->source = static_cast<int32_t>(signature.source);
+}
+
+// 计算已打开文件的签名
+pixraw_status signatureOpened(PixRaw::PixRaw& processor, const CancellationToken& token, pixraw_signature* out,
+                              std::string& error) {
+    PixRaw::ImageSignature signature = processor.computeSignature(token);
+    if (!signature.isValid()) {
+        error = processor.getLastError();
+        pixraw_status status = toStatus(processor.getLastStatus());
+        return status == PIXRAW_OK ? PIXRAW_ERROR : status;
+    }
+    copySignature(signature, out);
+    return PIXRAW_OK;
+}
+
+// 解码已打开的文件，成功时 *out 为新图像
+pixraw_status decodeOpened(PixRaw::PixRaw& processor, const pixraw_decode_options& options,
+                           const CancellationToken& token, pixraw_image** out, std::string& error) {
+    RawImage image;
+    switch (options.tier) {
+        case PIXRAW_TIER_QUICK:
+            image = processor.decodeQuickPreview(token);
+            break;
+        case PIXRAW_TIER_MEDIUM:
+            image = processor.decodeMediumPreview(token);
+            break;
+        case PIXRAW_TIER_FULL:
+            image = processor.decodeFull(token);
+            break;
+        case PIXRAW_TIER_THUMBNAIL:
+            image = processor.getThumbnail(token);
+            break;
+        case PIXRAW_TIER_SIGNATURE:
+            error = "Signature tier produces no image; use pixraw_get_signature()";
+            return PIXRAW_INVALID_ARGUMENT;
+        default:
+            image = processor.decodePreview(options.max_width, options.max_height, token);
+            break;
+    }
+
+    if (!image.isValid()) {
+        error = processor.getLastError();
+        pixraw_status status = toStatus(processor.getLastStatus());
+        return status == PIXRAW_OK ? PIXRAW_ERROR : status;
+    }
+
+    // 解码结果直接移入句柄，像素缓冲区不再拷贝
+    pixraw_image* handle = new pixraw_image();
+    handle->image = std::move(image);
+    *out = handle;
+    return PIXRAW_OK;
+}
+
+} // namespace
+
+// === 通用 ===
+
+uint32_t pixraw_abi_version(void) {
+    return PIXRAW_ABI_VERSION;
+}
+
+void pixraw_decode_options_init(pixraw_decode_options* options) {
+    if (!options) {
+        return;
+    }
+    options->struct_size = sizeof(pixraw_decode_options);
+    options->tier = PIXRAW_TIER_PREVIEW;
+    options->max_width = 1920;
+    options->max_height = 1080;
+    options->timeout_ms = 0;
+}
+
+// === 解码器 ===
+
+pixraw_decoder* pixraw_create(void) {
+    try {
+        return new pixraw_decoder();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void pixraw_destroy(pixraw_decoder* decoder) {
+    delete decoder;
+}
+
+pixraw_status pixraw_open_file(pixraw_decoder* decoder, const char* path) {
+    if (!decoder || !path) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    decoder->error.clear();
+    try {
+        if (!decoder->processor.open(std::string(path))) {
+            decoder->error = decoder->processor.getLastError();
+            return PIXRAW_ERROR;
+        }
+        return PIXRAW_OK;
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+pixraw_status pixraw_open_buffer(pixraw_decoder* decoder, const void* data, size_t size) {
+    if (!decoder || !data || size == 0) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    decoder->error.clear();
+    try {
+        if (!decoder->processor.openBuffer(data, size)) {
+            decoder->error = decoder->processor.getLastError();
+            return PIXRAW_ERROR;
+        }
+        return PIXRAW_OK;
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+void pixraw_close(pixraw_decoder* decoder) {
+    if (decoder) {
+        decoder->processor.close();
+    }
+}
+
+pixraw_status pixraw_get_metadata(pixraw_decoder* decoder, pixraw_metadata* out) {
+    if (!decoder || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+    if (!decoder->processor.isOpen()) {
+        decoder->error = "No file opened";
+        return PIXRAW_ERROR;
+    }
+
+    PixRaw::RawMetadata metadata;
+    try {
+        metadata = decoder->processor.getMetadata();
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+    std::memset(out, 0, sizeof(*out));
+    copyString(out->camera_make, sizeof(out->camera_make), metadata.camera_make);
+    copyString(out->camera_model, sizeof(out->camera_model), metadata.camera_model);
+    copyString(out->software, sizeof(out->software), metadata.software);
+    copyString(out->lens_model, sizeof(out->lens_model), metadata.lens_model);
+    out->image_width = metadata.image_width;
+    out->image_height = metadata.image_height;
+    out->raw_width = metadata.raw_width;
+    out->raw_height = metadata.raw_height;
+    out->iso = metadata.iso;
+    out->shutter_speed = metadata.shutter_speed;
+    out->aperture = metadata.aperture;
+    out->focal_length = metadata.focal_length;
+    out->timestamp = metadata.timestamp;
+    out->wb_red = metadata.wb_red;
+    out->wb_green = metadata.wb_green;
+    out->wb_blue = metadata.wb_blue;
+    out->orientation = metadata.orientation;
+    return PIXRAW_OK;
+}
+
+pixraw_status pixraw_get_signature(pixraw_decoder* decoder, pixraw_signature* out) {
+    if (!decoder || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+    try {
+        return signatureOpened(decoder->processor, CancellationToken(), out, decoder->error);
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+int32_t pixraw_signature_distance(const pixraw_signature* a, const pixraw_signature* b) {
+    if (!a || !b) {
+        return 64;
+    }
+    return PixRaw::ImageSignature::hashDistance(a->perceptual_hash, b->perceptual_hash);
+}
+
+pixraw_status pixraw_set_adjustments(pixraw_decoder* decoder, const pixraw_adjustments* adjustments) {
+    if (!decoder || !adjustments) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    PixRaw::RawAdjustments values;
+    values.exposure = adjustments->exposure;
+    values.contrast = adjustments->contrast;
+    values.highlights = adjustments->highlights;
+    values.shadows = adjustments->shadows;
+    values.saturation = adjustments->saturation;
+    values.temperature = adjustments->temperature;
+    values.tint = adjustments->tint;
+    try {
+        decoder->processor.setAdjustments(values);
+        return PIXRAW_OK;
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+pixraw_status pixraw_decode(pixraw_decoder* decoder, const pixraw_decode_options* options, pixraw_image** out) {
+    if (!decoder || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    *out = nullptr;
+    decoder->error.clear();
+    try {
+        pixraw_decode_options resolved = resolveOptions(options);
+        CancellationToken token = resolved.timeout_ms > 0 ? tokenFor(resolved) : CancellationToken();
+        return decodeOpened(decoder->processor, resolved, token, out, decoder->error);
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+pixraw_status pixraw_thumbnail_jpeg(pixraw_decoder* decoder, pixraw_blob** out) {
+    if (!decoder || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    *out = nullptr;
+    decoder->error.clear();
+    try {
+        PixRaw::RawData data = decoder->processor.getThumbnailData();
+        if (!data.isValid()) {
+            decoder->error = decoder->processor.getLastError();
+            return PIXRAW_ERROR;
+        }
+        pixraw_blob* blob = new pixraw_blob();
+        blob->data = std::move(data);
+        *out = blob;
+        return PIXRAW_OK;
+    } catch (const std::exception& e) {
+        decoder->error = e.what();
+        return PIXRAW_ERROR;
+    } catch (...) {
+        return PIXRAW_ERROR;
+    }
+}
+
+const char* pixraw_last_error(const pixraw_decoder* decoder) {
+    return decoder ? decoder->error.c_str() : "";
+}
+
+// === 图像 ===
+
+const uint8_t* pixraw_image_data(const pixraw_image* image) {
+    return image ? image->image.data() : nullptr;
+}
+
+int32_t pixraw_image_width(const pixraw_image* image) {
+    return image ? image->image.width() : 0;
+}
+
+int32_t pixraw_image_height(const pixraw_image* image) {
+    return image ? image->image.height() : 0;
+}
+
+size_t pixraw_image_stride(const pixraw_image* image) {
+    return image ? static_cast<size_t>(image->image.stride()) : 0;
+}
+
+int32_t pixraw_image_bytes_per_pixel(const pixraw_image* image) {
+    return image ? image->image.bytesPerPixel() : 0;
+}
+
+size_t pixraw_image_size(const pixraw_image* image) {
+    return image ? image->image.byteSize() : 0;
+}
+
+pixraw_pixel_format pixraw_image_format(const pixraw_image* image) {
+    if (image) {
+        switch (image->image.format()) {
+            case PixRaw::PixelFormat::RGBA8888:
+                return PIXRAW_FORMAT_RGBA8888;
+            case PixRaw::PixelFormat::RGB565:
+                return PIXRAW_FORMAT_RGB565;
+            case PixRaw::PixelFormat::RGB888:
+                break;
+        }
+    }
+    return PIXRAW_FORMAT_RGB888;
+}
+
+pixraw_image* pixraw_image_retain(pixraw_image* image) {
+    if (image) {
+        image->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    return image;
+}
+
+void pixraw_image_release(pixraw_image* image) {
+    if (image && image->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete image;
+    }
+}
+
+// === 字节数据 ===
+
+const uint8_t* pixraw_blob_data(const pixraw_blob* blob) {
+    return blob ? blob->data.data() : nullptr;
+}
+
+size_t pixraw_blob_size(const pixraw_blob* blob) {
+    return blob ? blob->data.size() : 0;
+}
+
+void pixraw_blob_release(pixraw_blob* blob) {
+    delete blob;
+}
+
+// === 批处理 ===
+
+namespace {
+
+struct BatchJob {
+    int64_t id = 0;
+    std::string path;               // 为空时使用 data/size
+    const void* data = nullptr;
+    size_t size = 0;
+    pixraw_decode_options options;
+    CancellationToken token;
+
+    bool started = false;
+    bool done = false;
+    pixraw_status status = PIXRAW_PENDING;
+    pixraw_image* image = nullptr;
+    pixraw_signature signature{};
+    std::string error;
+};
+
+} // namespace
+
+struct pixraw_batch {
+    std::mutex mutex;
+    std::condition_variable work_cv;    // 通知工作线程
+    std::condition_variable done_cv;    // 通知 poll
+    std::deque<std::shared_ptr<BatchJob>> queue;
+    std::unordered_map<int64_t, std::shared_ptr<BatchJob>> jobs;   // 结果尚未取走的任务
+    std::deque<int64_t> completed;      // 完成顺序
+    std::vector<std::thread> workers;
+    int64_t next_id = 1;
+    bool stopping = false;
+
+    // 调用时需持有 mutex
+    void complete(const std::shared_ptr<BatchJob>& job) {
+        job->done = true;
+        completed.push_back(job->id);
+        done_cv.notify_all();
+    }
+
+    void run() {
+        // 每个工作线程复用一个解码器
+        PixRaw::PixRaw processor;
+
+        for (;;) {
+            std::shared_ptr<BatchJob> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    return;
+                }
+                job = std::move(queue.front());
+                queue.pop_front();
+                job->started = true;
+            }
+
+            pixraw_image* image = nullptr;
+            pixraw_signature signature{};
+            std::string error;
+            pixraw_status status;
+            try {
+                status = execute(processor, *job, &image, &signature, error);
+            } catch (const std::exception& e) {
+                error = e.what();
+                status = PIXRAW_ERROR;
+            } catch (...) {
+                error = "Unknown error";
+                status = PIXRAW_ERROR;
+            }
+            processor.close();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            job->status = status;
+            job->image = image;
+            job->signature = signature;
+            job->error = std::move(error);
+            complete(job);
+        }
+    }
+
+    static pixraw_status execute(PixRaw::PixRaw& processor, const BatchJob& job, pixraw_image** out,
+                                 pixraw_signature* signature, std::string& error) {
+        DecodeStatus before = job.token.status();
+        if (before != DecodeStatus::Success) {
+            error = before == DecodeStatus::DeadlineExceeded ? "Deadline exceeded" : "Cancelled";
+            return toStatus(before);
+        }
+
+        bool opened = job.path.empty() ? processor.openBuffer(job.data, job.size) : processor.open(job.path);
+        if (!opened) {
+            error = processor.getLastError();
+            return PIXRAW_ERROR;
+        }
+        if (job.options.tier == PIXRAW_TIER_SIGNATURE) {
+            return signatureOpened(processor, job.token, signature, error);
+        }
+        return decodeOpened(processor, job.options, job.token, out, error);
+    }
+
+    int64_t submit(std::shared_ptr<BatchJob> job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return -1;
+        }
+        int64_t id = next_id++;
+        job->id = id;
+        jobs[id] = job;
+        queue.push_back(std::move(job));
+        work_cv.notify_one();
+        return id;
+    }
+
+    // 调用时需持有 mutex
+    void take(const std::shared_ptr<BatchJob>& job, pixraw_result* out) {
+        out->job = job->id;
+        out->status = job->status;
+        out->image = job->image;
+        copyString(out->error, sizeof(out->error), job->error);
+        out->signature = job->signature;
+        job->image = nullptr;
+        jobs.erase(job->id);
+        done_cv.notify_all();   // 其他 poll 重新检查任务是否仍在
+    }
+};
+
+pixraw_batch* pixraw_batch_create(int32_t threads) {
+    try {
+        if (threads <= 0) {
+            threads = static_cast<int32_t>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        pixraw_batch* batch = new pixraw_batch();
+        for (int32_t i = 0; i < threads; ++i) {
+            batch->workers.emplace_back([batch] { batch->run(); });
+        }
+        return batch;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void pixraw_batch_destroy(pixraw_batch* batch) {
+    if (!batch) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->stopping = true;
+        for (auto& entry : batch->jobs) {
+            entry.second->token.cancel();
+        }
+        batch->queue.clear();
+        batch->work_cv.notify_all();
+    }
+
+    for (auto& worker : batch->workers) {
+        worker.join();
+    }
+
+    for (auto& entry : batch->jobs) {
+        pixraw_image_release(entry.second->image);
+    }
+    delete batch;
+}
+
+int64_t pixraw_batch_submit_file(pixraw_batch* batch, const char* path, const pixraw_decode_options* options) {
+    if (!batch || !path) {
+        return -1;
+    }
+
+    try {
+        auto job = std::make_shared<BatchJob>();
+        job->path = path;
+        job->options = resolveOptions(options);
+        job->token = tokenFor(job->options);  // 截止时间从提交时开始计算
+        return batch->submit(std::move(job));
+    } catch (...) {
+        return -1;
+    }
+}
+
+int64_t pixraw_batch_submit_buffer(pixraw_batch* batch, const void* data, size_t size,
+                                   const pixraw_decode_options* options) {
+    if (!batch || !data || size == 0) {
+        return -1;
+    }
+
+    try {
+        auto job = std::make_shared<BatchJob>();
+        job->data = data;
+        job->size = size;
+        job->options = resolveOptions(options);
+        job->token = tokenFor(job->options);
+        return batch->submit(std::move(job));
+    } catch (...) {
+        return -1;
+    }
+}
+
+pixraw_status pixraw_batch_poll(pixraw_batch* batch, int64_t job, int32_t timeout_ms, pixraw_result* out) {
+    if (!batch || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    auto it = batch->jobs.find(job);
+    if (it == batch->jobs.end()) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    std::shared_ptr<BatchJob> entry = it->second;
+    auto ready = [&entry] { return entry->done; };
+    if (timeout_ms < 0) {
+        batch->done_cv.wait(lock, ready);
+    } else if (!batch->done_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+        return PIXRAW_PENDING;
+    }
+
+    // 等待期间结果可能已被 pixraw_batch_poll_any() 或另一个 poll 取走
+    auto& completed = batch->completed;
+    auto done = std::find(completed.begin(), completed.end(), job);
+    if (batch->jobs.find(job) == batch->jobs.end() || done == completed.end()) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+    completed.erase(done);
+    batch->take(entry, out);
+    return PIXRAW_OK;
+}
+
+pixraw_status pixraw_batch_poll_any(pixraw_batch* batch, int32_t timeout_ms, pixraw_result* out) {
+    if (!batch || !out) {
+        return PIXRAW_INVALID_ARGUMENT;
+    }
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    // 剩余任务在等待期间被 pixraw_batch_poll() 全部取走时不再等待
+    auto ready = [batch] { return !batch->completed.empty() || batch->jobs.empty(); };
+    if (timeout_ms < 0) {
+        batch->done_cv.wait(lock, ready);
+    } else if (!batch->done_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready)) {
+        return PIXRAW_PENDING;
+    }
+    if (batch->completed.empty()) {
+        return PIXRAW_INVALID_ARGUMENT;  // 没有可等待的任务
+    }
+
+    int64_t job = batch->completed.front();
+    batch->completed.pop_front();
+    batch->take(batch->jobs.at(job), out);
+    return PIXRAW_OK;
+}
+
+void pixraw_batch_cancel(pixraw_batch* batch, int64_t job) {
+    if (!batch) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    auto it = batch->jobs.find(job);
+    if (it == batch->jobs.end() || it->second->done) {
+        return;
+    }
+
+    std::shared_ptr<BatchJob> entry = it->second;
+    entry->token.cancel();
+    if (!entry->started) {
+        // 尚未开始：直接从队列移除并完成
+        auto& queue = batch->queue;
+        queue.erase(std::find(queue.begin(), queue.end(), entry));
+        entry->status = PIXRAW_CANCELLED;
+        entry->error = "Cancelled";
+        batch->complete(entry);
+    }
+}
@@ -0,0 +1,323 @@
+#include "PlanarImage.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+
+namespace PixRaw {
+
+namespace {
+
+constexpr int kPlaneAlignment = 64;  // 字节
+
+std::shared_ptr<float> allocatePlanes(size_t count) {
+    std::align_val_t align{kPlaneAlignment};
+    float* ptr = static_cast<float*>(::operator new[](count * sizeof(float), align));
+    return std::shared_ptr<float>(ptr, [align](float* p) { ::operator delete[](p, align); });
+}
+
+inline float saturate(float value) {
+    return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// [0, 1] -> [0, max]，四舍五入
+inline int quantize(float value, float max) {
+    return static_cast<int>(saturate(value) * max + 0.5f);
+}
+
+} // namespace
+
+// === PlanarImage 实现 ===
+
+PlanarImage::PlanarImage() = default;
+
+PlanarImage::PlanarImage(int width, int height)
+    : width_(width)
+    , height_(height)
+{
+    if (width <= 0 || height <= 0) {
+        width_ = 0;
+        height_ = 0;
+        return;
+    }
+
+    // 行跨度向上取整到对齐的 float 数，使每个平面的每行都从对齐地址开始
+    constexpr int floats_per_line = kPlaneAlignment / static_cast<int>(sizeof(float));
+    stride_ = (width + floats_per_line - 1) / floats_per_line * floats_per_line;
+
+    size_t count = planeSize() * kChannels;
+    buffer_ = allocatePlanes(count);
+    data_ = buffer_.get();
+    std::memset(data_, 0, count * sizeof(float));
+}
+
+PlanarImage::~PlanarImage() = default;
+
+PlanarImage::PlanarImage(PlanarImage&& other) noexcept
+    : width_(other.width_)
+    , height_(other.height_)
+    , stride_(other.stride_)
+    , buffer_(std::move(other.buffer_))
+    , data_(other.data_)
+{
+    other.width_ = 0;
+    other.height_ = 0;
+    other.stride_ = 0;
+    other.data_ = nullptr;
+}
+
+PlanarImage& PlanarImage::operator=(PlanarImage&& other) noexcept {
+    if (this != &other) {
+        width_ = other.width_;
+        height_ = other.height_;
+        stride_ = other.stride_;
+        buffer_ = std::move(other.buffer_);
+        data_ = other.data_;
+
+        other.width_ = 0;
+        other.height_ = 0;
+        other.stride_ = 0;
+        other.data_ = nullptr;
+    }
+    return *this;
+}
+
+PlanarImage PlanarImage::fromInterleaved(const RawImage& image) {
+    if (!image.isValid()) {
+        return PlanarImage();
+    }
+
+    PlanarImage result(image.width(), image.height());
+    const float scale = 1.0f / 255.0f;
+
+    for (int y = 0; y < image.height(); ++y) {
+        const uint8_t* src = image.row(y);
+        float* r = result.row(0, y);
+        float* g = result.row(1, y);
+        float* b = result.row(2, y);
+
+        switch (image.format()) {
+            case PixelFormat::RGB888:
+            case PixelFormat::RGBA8888: {
+                int bpp = image.bytesPerPixel();
+                for (int x = 0; x < image.width(); ++x) {
+                    r[x] = src[x * bpp + 0] * scale;
+                    g[x] = src[x * bpp + 1] * scale;
+                    b[x] = src[x * bpp + 2] * scale;
+                }
+                break;
+            }
+            case PixelFormat::RGB565: {
+                for (int x = 0; x < image.width(); ++x) {
+                    uint16_t p = static_cast<uint16_t>(src[x * 2] | (src[x * 2 + 1] << 8));
+                    r[x] = ((p >> 11) & 0x1F) / 31.0f;
+                    g[x] = ((p >> 5) & 0x3F) / 63.0f;
+                    b[x] = (p & 0x1F) / 31.0f;
+                }
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+PlanarImage PlanarImage::fromPacked(const void* data, int width, int height, int bits) {
+    if (!data || (bits != 8 && bits != 16)) {
+        return PlanarImage();
+    }
+
+    PlanarImage result(width, height);
+    if (!result.isValid()) {
+        return result;
+    }
+
+    for (int y = 0; y < height; ++y) {
+        float* r = result.row(0, y);
+        float* g = result.row(1, y);
+        float* b = result.row(2, y);
+
+        if (bits == 16) {
+            const uint16_t* src = static_cast<const uint16_t*>(data) + static_cast<size_t>(y) * width * 3;
+            const float scale = 1.0f / 65535.0f;
+            for (int x = 0; x < width; ++x) {
+                r[x] = src[x * 3 + 0] * scale;
+                g[x] = src[x * 3 + 1] * scale;
+                b[x] = src[x * 3 + 2] * scale;
+            }
+        } else {
+            const uint8_t* src = static_cast<const uint8_t*>(data) + static_cast<size_t>(y) * width * 3;
+            const float scale = 1.0f / 255.0f;
+            for (int x = 0; x < width; ++x) {
+                r[x] = src[x * 3 + 0] * scale;
+                g[x] = src[x * 3 + 1] * scale;
+                b[x] = src[x * 3 + 2] * scale;
+            }
+        }
+    }
+
+    return result;
+}
+
+RawImage PlanarImage::toInterleaved(PixelFormat format, ImageStatistics* stats,
+                                    const StatisticsOptions& options,
+                                    const CancellationToken& token) const {
+    if (!data_) {
+        return RawImage();
+    }
+
+    RawImage result(width_, height_, format);
+
+    // 统计与最终写出融合在同一次逐行遍历中，每个线程累加后再合并
+    const bool collect = stats != nullptr && options.enabled;
+    std::unique_ptr<StatisticsAccumulator> total;
+    if (collect) {
+        *stats = ImageStatistics();
+        if (options.clip_mask) {
+            stats->clip_mask.assign(static_cast<size_t>(width_) * height_, 0);
+            stats->mask_width = width_;
+            stats->mask_height = height_;
+        }
+        total = std::make_unique<StatisticsAccumulator>(options);
+    }
+    uint8_t* mask = (collect && options.clip_mask) ? stats->clip_mask.data() : nullptr;
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        std::unique_ptr<StatisticsAccumulator> local;
+        if (collect) {
+            local = std::make_unique<StatisticsAccumulator>(options);
+        }
+
+#pragma omp for schedule(static)
+        for (int y = 0; y < height_; ++y) {
+            if (cancel.skip(y)) {
+                continue;
+            }
+
+            const float* r = row(0, y);
+            const float* g = row(1, y);
+            const float* b = row(2, y);
+            uint8_t* dst = result.row(y);
+
+            switch (format) {
+                case PixelFormat::RGB888:
+                    for (int x = 0; x < width_; ++x) {
+                        dst[x * 3 + 0] = static_cast<uint8_t>(quantize(r[x], 255.0f));
+                        dst[x * 3 + 1] = static_cast<uint8_t>(quantize(g[x], 255.0f));
+                        dst[x * 3 + 2] = static_cast<uint8_t>(quantize(b[x], 255.0f));
+                    }
+                    break;
+                case PixelFormat::RGBA8888:
+                    for (int x = 0; x < width_; ++x) {
+                        dst[x * 4 + 0] = static_cast<uint8_t>(quantize(r[x], 255.0f));
+                        dst[x * 4 + 1] = static_cast<uint8_t>(quantize(g[x], 255.0f));
+                        dst[x * 4 + 2] = static_cast<uint8_t>(quantize(b[x], 255.0f));
+                        dst[x * 4 + 3] = 255;
+                    }
+                    break;
+                case PixelFormat::RGB565:
+                    for (int x = 0; x < width_; ++x) {
+                        uint16_t p = static_cast<uint16_t>((quantize(r[x], 31.0f) << 11) |
+                                                           (quantize(g[x], 63.0f) << 5) |
+                                                           quantize(b[x], 31.0f));
+                        dst[x * 2 + 0] = static_cast<uint8_t>(p & 0xFF);
+                        dst[x * 2 + 1] = static_cast<uint8_t>(p >> 8);
+                    }
+                    break;
+            }
+
+            if (local) {
+                uint8_t* mask_row = mask ? mask + static_cast<size_t>(y) * width_ : nullptr;
+                for (int x = 0; x < width_; ++x) {
+                    float luma = 0.2126f * saturate(r[x]) + 0.7152f * saturate(g[x]) + 0.0722f * saturate(b[x]);
+                    uint8_t bits = local->addPixel(local->bin(r[x]), local->bin(g[x]), local->bin(b[x]), local->bin(luma));
+                    if (mask_row) mask_row[x] = bits;
+                }
+            }
+        }
+
+        if (local) {
+#pragma omp critical(pixraw_statistics_merge)
+            total->merge(*local);
+        }
+    }
+
+    if (cancel.stopped()) {
+        if (collect) {
+            *stats = ImageStatistics();
+        }
+        return RawImage();
+    }
+
+    if (collect) {
+        total->finish(*stats);
+    }
+
+    return result;
+}
+
+void PlanarImage::resampleInto(PlanarImage& dst, int x, int y, int width, int height,
+                               const CancellationToken& token) const {
+    if (!data_ || !dst.isValid() || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > width_ || y + height > height_) {
+        return;
+    }
+
+    const int out_width = dst.width();
+    const int out_height = dst.height();
+
+    // 每个输出列/行对应的源区间 [begin, end)，放大时区间退化为单个像素
+    std::vector<int> columns(static_cast<size_t>(out_width) + 1);
+    for (int i = 0; i <= out_width; ++i) {
+        columns[i] = x + static_cast<int>(static_cast<int64_t>(i) * width / out_width);
+    }
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel for schedule(static)
+    for (int oy = 0; oy < out_height; ++oy) {
+        if (cancel.skip(oy)) {
+            continue;
+        }
+
+        int y0 = y + static_cast<int>(static_cast<int64_t>(oy) * height / out_height);
+        int y1 = std::max(y + static_cast<int>(static_cast<int64_t>(oy + 1) * height / out_height), y0 + 1);
+
+        for (int c = 0; c < kChannels; ++c) {
+            float* out = dst.row(c, oy);
+            for (int ox = 0; ox < out_width; ++ox) {
+                int x0 = columns[ox];
+                int x1 = std::max(columns[ox + 1], x0 + 1);
+                float sum = 0.0f;
+                for (int sy = y0; sy < y1; ++sy) {
+                    const float* in = row(c, sy);
+                    for (int sx = x0; sx < x1; ++sx) {
+                        sum += in[sx];
+                    }
+                }
+                out[ox] = sum / static_cast<float>((x1 - x0) * (y1 - y0));
+            }
+        }
+    }
+}
+
+PlanarImage PlanarImage::clone() const {
+    if (!data_) {
+        return PlanarImage();
+    }
+
+    PlanarImage copy(width_, height_);
+    std::memcpy(copy.data_, data_, planeSize() * kChannels * sizeof(float));
+    return copy;
+}
+
+void PlanarImage::swap(PlanarImage& other) noexcept {
+    std::swap(width_, other.width_);
+    std::swap(height_, other.height_);
+    std::swap(stride_, other.stride_);
+    std::swap(buffer_, other.buffer_);
+    std::swap(data_, other.data_);
+}
+
+} // namespace PixRaw
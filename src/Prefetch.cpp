@@ -0,0 +1,408 @@
+#include "Prefetch.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PixRaw {
+
+namespace {
+
+// 缓冲区按 1 MiB 向上取整分配，大小相近的 RAW 可以互相复用
+constexpr size_t kBufferGranularity = size_t(1) << 20;
+
+double elapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+#ifndef _WIN32
+// 提示内核开始异步预读整个文件（只发出提示，不等待）
+void adviseWillNeed(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+#ifdef POSIX_FADV_WILLNEED
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+    ::close(fd);
+}
+#endif
+
+} // namespace
+
+/**
+ * 预取缓冲池：读取线程取用，PrefetchedFile 析构时归还
+ */
+class PrefetchBufferPool {
+public:
+    explicit PrefetchBufferPool(size_t max_free) : max_free_(max_free) {}
+
+    // 为 file 分配至少 size 字节的缓冲区
+    bool acquire(size_t size, PrefetchedFile& file) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // 最佳适配：容量足够的最小空闲缓冲区
+            auto best = free_.end();
+            for (auto it = free_.begin(); it != free_.end(); ++it) {
+                if (it->second >= size && (best == free_.end() || it->second < best->second)) {
+                    best = it;
+                }
+            }
+            if (best != free_.end()) {
+                file.data_ = std::move(best->first);
+                file.capacity_ = best->second;
+                free_.erase(best);
+                ++reused_;
+                return true;
+            }
+        }
+
+        size_t capacity = std::max<size_t>((size + kBufferGranularity - 1) / kBufferGranularity, 1) * kBufferGranularity;
+        file.data_.reset(new (std::nothrow) uint8_t[capacity]);  // 不清零，随后被文件内容覆盖
+        if (!file.data_) {
+            return false;
+        }
+        file.capacity_ = capacity;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++allocated_;
+        return true;
+    }
+
+    void release(std::unique_ptr<uint8_t[]> data, size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.emplace_back(std::move(data), capacity);
+        if (free_.size() > max_free_) {
+            // 超出上限时丢弃最小的（最不可能被复用）
+            auto smallest = std::min_element(free_.begin(), free_.end(),
+                                             [](const Entry& a, const Entry& b) { return a.second < b.second; });
+            free_.erase(smallest);
+        }
+    }
+
+    void counters(uint64_t& allocated, uint64_t& reused) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        allocated = allocated_;
+        reused = reused_;
+    }
+
+private:
+    using Entry = std::pair<std::unique_ptr<uint8_t[]>, size_t>;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> free_;
+    size_t max_free_;
+    uint64_t allocated_ = 0;
+    uint64_t reused_ = 0;
+};
+
+// === PrefetchStats ===
+
+double PrefetchStats::overlap() const {
+    if (read_ms <= 0.0) {
+        return 0.0;
+    }
+    return std::min(std::max(1.0 - wait_ms / read_ms, 0.0), 1.0);
+}
+
+// === PrefetchedFile ===
+
+PrefetchedFile::PrefetchedFile() = default;
+
+PrefetchedFile::~PrefetchedFile() { release(); }
+
+PrefetchedFile::PrefetchedFile(PrefetchedFile&& other) noexcept
+    : path_(std::move(other.path_)),
+      error_(std::move(other.error_)),
+      data_(std::move(other.data_)),
+      size_(other.size_),
+      capacity_(other.capacity_),
+      pool_(std::move(other.pool_)) {
+    other.size_ = 0;
+    other.capacity_ = 0;
+}
+
+PrefetchedFile& PrefetchedFile::operator=(PrefetchedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        path_ = std::move(other.path_);
+        error_ = std::move(other.error_);
+        data_ = std::move(other.data_);
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+        pool_ = std::move(other.pool_);
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+    return *this;
+}
+
+void PrefetchedFile::release() {
+    if (data_ && pool_) {
+        pool_->release(std::move(data_), capacity_);
+    }
+    data_.reset();
+    pool_.reset();
+    path_.clear();
+    error_.clear();
+    size_ = 0;
+    capacity_ = 0;
+}
+
+// === PrefetchQueue ===
+
+class PrefetchQueue::Impl {
+public:
+    Impl(std::vector<std::string> paths, const PrefetchOptions& options)
+        : paths_(std::move(paths)),
+          options_(options),
+          results_(paths_.size()),
+          ready_(paths_.size(), 0) {
+        options_.depth = std::max(options_.depth, 1);
+        options_.io_threads = std::min(std::max(options_.io_threads, 1), options_.depth);
+        options_.advise_ahead = std::max(options_.advise_ahead, 0);
+
+        // 池中保留的空闲缓冲区：预取窗口 + 调用者手上的一个
+        pool_ = std::make_shared<PrefetchBufferPool>(static_cast<size_t>(options_.depth) + 1);
+
+        int threads = static_cast<int>(std::min<size_t>(options_.io_threads, paths_.size()));
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        space_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    bool next(PrefetchedFile& file) {
+        file = PrefetchedFile();  // 先归还上一个缓冲区，供读取线程复用
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (consumed_ >= paths_.size()) {
+            return false;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (delivered_any_) {
+            stats_.compute_ms += elapsedMs(last_return_, now);
+        } else {
+            first_call_ = now;
+        }
+
+        const size_t index = consumed_;
+        ready_cv_.wait(lock, [&] { return ready_[index] != 0; });
+        auto ready = std::chrono::steady_clock::now();
+        stats_.wait_ms += elapsedMs(now, ready);
+
+        file = std::move(results_[index]);
+        ++consumed_;
+        ++stats_.files;
+        if (!file.isValid()) {
+            ++stats_.failed;
+        }
+
+        delivered_any_ = true;
+        last_return_ = ready;
+        stats_.wall_ms = elapsedMs(first_call_, ready);
+        lock.unlock();
+
+        space_.notify_all();
+        return true;
+    }
+
+    size_t size() const { return paths_.size(); }
+
+    PrefetchStats stats() const {
+        PrefetchStats stats;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats = stats_;
+        }
+        pool_->counters(stats.buffers_allocated, stats.buffers_reused);
+        return stats;
+    }
+
+private:
+    void workerLoop() {
+        for (;;) {
+            size_t index;
+            size_t advise_from;
+            size_t advise_to;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                space_.wait(lock, [&] {
+                    return stop_ || claimed_ >= paths_.size() ||
+                           claimed_ - consumed_ < static_cast<size_t>(options_.depth);
+                });
+                if (stop_ || claimed_ >= paths_.size()) {
+                    return;
+                }
+                index = claimed_++;
+
+                // 预取窗口之后的文件只发出预读提示
+                advise_from = std::max(advised_, index + options_.depth);
+                advise_to = std::min(paths_.size(), index + options_.depth + options_.advise_ahead);
+                advised_ = std::max(advised_, advise_to);
+            }
+
+#ifndef _WIN32
+            for (size_t i = advise_from; i < advise_to; ++i) {
+                adviseWillNeed(paths_[i]);
+            }
+#else
+            (void)advise_from;
+            (void)advise_to;
+#endif
+
+            PrefetchedFile file;
+            file.path_ = paths_[index];
+            file.pool_ = pool_;
+            auto start = std::chrono::steady_clock::now();
+            readFile(file);
+            double ms = elapsedMs(start, std::chrono::steady_clock::now());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stats_.read_ms += ms;
+                stats_.bytes_read += file.size_;
+                results_[index] = std::move(file);
+                ready_[index] = 1;
+            }
+            ready_cv_.notify_one();
+        }
+    }
+
+    void readFile(PrefetchedFile& file) {
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(file.path_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            file.error_ = "Failed to open file";
+            return;
+        }
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(handle, &length) || length.QuadPart <= 0) {
+            CloseHandle(handle);
+            file.error_ = "Empty or unreadable file";
+            return;
+        }
+        size_t size = static_cast<size_t>(length.QuadPart);
+        if (!pool_->acquire(size, file)) {
+            CloseHandle(handle);
+            file.error_ = "Out of memory";
+            return;
+        }
+        size_t total = 0;
+        while (total < size) {
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(size - total, 1u << 30));
+            DWORD got = 0;
+            if (!ReadFile(handle, file.data_.get() + total, chunk, &got, nullptr) || got == 0) {
+                break;
+            }
+            total += got;
+        }
+        CloseHandle(handle);
+#else
+        int fd = ::open(file.path_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            file.error_ = "Failed to open file: " + std::string(std::strerror(errno));
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            ::close(fd);
+            file.error_ = "Empty or unreadable file";
+            return;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+        (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        if (!pool_->acquire(size, file)) {
+            ::close(fd);
+            file.error_ = "Out of memory";
+            return;
+        }
+        size_t total = 0;
+        while (total < size) {
+            ssize_t got = pread(fd, file.data_.get() + total, size - total, static_cast<off_t>(total));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                break;
+            }
+            total += static_cast<size_t>(got);
+        }
+#ifdef POSIX_FADV_DONTNEED
+        if (options_.drop_cache) {
+            (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        }
+#endif
+        ::close(fd);
+#endif
+        if (total != size) {
+            file.error_ = "Short read";
+            return;
+        }
+        file.size_ = size;
+    }
+
+    std::vector<std::string> paths_;
+    PrefetchOptions options_;
+    std::shared_ptr<PrefetchBufferPool> pool_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable space_;     // 预取窗口有空位
+    std::condition_variable ready_cv_;  // 有文件读完
+    std::vector<PrefetchedFile> results_;
+    std::vector<char> ready_;
+    size_t claimed_ = 0;    // 下一个要读取的文件
+    size_t consumed_ = 0;   // 下一个要交付的文件
+    size_t advised_ = 0;    // 已发出预读提示的文件数
+    bool stop_ = false;
+
+    PrefetchStats stats_;
+    bool delivered_any_ = false;
+    std::chrono::steady_clock::time_point first_call_;
+    std::chrono::steady_clock::time_point last_return_;
+
+    std::vector<std::thread> workers_;
+};
+
+PrefetchQueue::PrefetchQueue(std::vector<std::string> paths, const PrefetchOptions& options)
+    : impl_(std::make_unique<Impl>(std::move(paths), options)) {}
+
+PrefetchQueue::~PrefetchQueue() = default;
+
+bool PrefetchQueue::next(PrefetchedFile& file) { return impl_->next(file); }
+
+size_t PrefetchQueue::size() const { return impl_->size(); }
+
+PrefetchStats PrefetchQueue::stats() const { return impl_->stats(); }
+
+} // namespace PixRaw
@@ -1,6 +1,7 @@
 #include "RawImage.h"
 #include <cstring>
 #include <algorithm>
+#include <new>
 #include <stdexcept>
 
 namespace PixRaw {
@@ -15,20 +16,47 @@ int bytesPerPixelForFormat(PixelFormat format) {
     return 3;
 }
 
+namespace {
+
+// 对齐分配，释放时使用匹配的对齐 delete
+std::shared_ptr<uint8_t> allocateAligned(size_t size, int alignment) {
+    std::align_val_t align{static_cast<size_t>(alignment)};
+    uint8_t* ptr = static_cast<uint8_t*>(::operator new[](size, align));
+    return std::shared_ptr<uint8_t>(ptr, [align](uint8_t* p) { ::operator delete[](p, align); });
+}
+
+int alignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
 // === RawImage 实现 ===
 
 RawImage::RawImage() = default;
 
-RawImage::RawImage(int width, int height, PixelFormat format)
+RawImage::RawImage(int width, int height, PixelFormat format, int alignment)
     : width_(width)
     , height_(height)
-    , stride_(width * bytesPerPixelForFormat(format))
     , format_(format)
 {
-    int bpp = bytesPerPixelForFormat(format);
-    size_t size = width * height * bpp;
-    data_ = std::make_unique<uint8_t[]>(size);
-    std::memset(data_.get(), 0, size);
+    if (width <= 0 || height <= 0) {
+        width_ = 0;
+        height_ = 0;
+        return;
+    }
+
+    // 行对齐必须是 2 的幂；alignment = 1 表示紧密排列
+    if (alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+        alignment = kDefaultAlignment;
+    }
+
+    stride_ = alignUp(width * bytesPerPixelForFormat(format), alignment);
+    size_t size = static_cast<size_t>(stride_) * height;
+    // 缓冲区起始地址始终按默认对齐分配
+    buffer_ = allocateAligned(size, std::max(alignment, kDefaultAlignment));
+    data_ = buffer_.get();
+    std::memset(data_, 0, size);
 }
 
 RawImage::~RawImage() = default;
@@ -38,11 +66,15 @@ RawImage::RawImage(RawImage&& other) noexcept
     , height_(other.height_)
     , stride_(other.stride_)
     , format_(other.format_)
-    , data_(std::move(other.data_))
+    , view_(other.view_)
+    , buffer_(std::move(other.buffer_))
+    , data_(other.data_)
 {
     other.width_ = 0;
     other.height_ = 0;
     other.stride_ = 0;
+    other.view_ = false;
+    other.data_ = nullptr;
 }
 
 RawImage& RawImage::operator=(RawImage&& other) noexcept {
@@ -51,15 +83,33 @@ RawImage& RawImage::operator=(RawImage&& other) noexcept {
         height_ = other.height_;
         stride_ = other.stride_;
         format_ = other.format_;
-        data_ = std::move(other.data_);
+        view_ = other.view_;
+        buffer_ = std::move(other.buffer_);
+        data_ = other.data_;
 
         other.width_ = 0;
         other.height_ = 0;
         other.stride_ = 0;
+        other.view_ = false;
+        other.data_ = nullptr;
     }
     return *this;
 }
 
+RawImage RawImage::wrap(uint8_t* data, int width, int height, int stride, PixelFormat format) {
+    RawImage image;
+    if (!data || width <= 0 || height <= 0 || stride < width * bytesPerPixelForFormat(format)) {
+        return image;
+    }
+    image.width_ = width;
+    image.height_ = height;
+    image.stride_ = stride;
+    image.format_ = format;
+    image.view_ = true;
+    image.data_ = data;
+    return image;
+}
+
 int RawImage::bytesPerPixel() const {
     return bytesPerPixelForFormat(format_);
 }
@@ -75,23 +125,23 @@ bool RawImage::save(const std::string& filepath, int quality) const {
 RawImage RawImage::convertTo(PixelFormat target_format) const {
     if (format_ == target_format || !data_) {
         // 不能返回 *this，创建一个副本
-        RawImage copy(width_, height_, format_);
-        std::memcpy(copy.data_.get(), data_.get(), width_ * height_ * bytesPerPixel());
-        return copy;
+        return clone();
     }
 
     RawImage result(width_, height_, target_format);
 
     // 简化：只实现 RGB888 -> RGBA8888
     if (format_ == PixelFormat::RGB888 && target_format == PixelFormat::RGBA8888) {
-        const uint8_t* src = data_.get();
-        uint8_t* dst = result.data_.get();
-
-        for (int i = 0; i < width_ * height_; ++i) {
-            dst[i * 4 + 0] = src[i * 3 + 0];  // R
-            dst[i * 4 + 1] = src[i * 3 + 1];  // G
-            dst[i * 4 + 2] = src[i * 3 + 2];  // B
-            dst[i * 4 + 3] = 255;             // A
+        for (int y = 0; y < height_; ++y) {
+            const uint8_t* src = row(y);
+            uint8_t* dst = result.row(y);
+
+            for (int x = 0; x < width_; ++x) {
+                dst[x * 4 + 0] = src[x * 3 + 0];  // R
+                dst[x * 4 + 1] = src[x * 3 + 1];  // G
+                dst[x * 4 + 2] = src[x * 3 + 2];  // B
+                dst[x * 4 + 3] = 255;             // A
+            }
         }
     }
 
@@ -110,32 +160,61 @@ RawImage RawImage::resize(int new_width, int new_height) const {
     float y_ratio = static_cast<float>(height_) / new_height;
     int bpp = bytesPerPixel();
 
-    const uint8_t* src = data_.get();
-    uint8_t* dst = result.data_.get();
-
     for (int y = 0; y < new_height; ++y) {
+        int src_y = static_cast<int>(y * y_ratio);
+        if (src_y >= height_) src_y = height_ - 1;
+
+        const uint8_t* src = row(src_y);
+        uint8_t* dst = result.row(y);
+
         for (int x = 0; x < new_width; ++x) {
             int src_x = static_cast<int>(x * x_ratio);
-            int src_y = static_cast<int>(y * y_ratio);
-
             if (src_x >= width_) src_x = width_ - 1;
-            if (src_y >= height_) src_y = height_ - 1;
 
-            int src_offset = (src_y * width_ + src_x) * bpp;
-            int dst_offset = (y * new_width + x) * bpp;
-
-            std::memcpy(dst + dst_offset, src + src_offset, bpp);
+            std::memcpy(dst + x * bpp, src + src_x * bpp, bpp);
         }
     }
 
     return result;
 }
 
+RawImage RawImage::crop(int x, int y, int width, int height) {
+    if (!data_ || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x >= width_ || y >= height_ || width > width_ - x || height > height_ - y) {
+        return RawImage();
+    }
+
+    RawImage view;
+    view.width_ = width;
+    view.height_ = height;
+    view.stride_ = stride_;
+    view.format_ = format_;
+    view.view_ = true;
+    view.buffer_ = buffer_;  // 共享所有权，原图释放后视图仍然有效
+    view.data_ = data_ + static_cast<size_t>(y) * stride_ + static_cast<size_t>(x) * bytesPerPixel();
+    return view;
+}
+
+RawImage RawImage::clone() const {
+    if (!data_) {
+        return RawImage();
+    }
+
+    RawImage copy(width_, height_, format_);
+    int bytes = rowBytes();
+    for (int y = 0; y < height_; ++y) {
+        std::memcpy(copy.row(y), row(y), bytes);
+    }
+    return copy;
+}
+
 void RawImage::swap(RawImage& other) noexcept {
     std::swap(width_, other.width_);
     std::swap(height_, other.height_);
     std::swap(stride_, other.stride_);
     std::swap(format_, other.format_);
+    std::swap(view_, other.view_);
+    std::swap(buffer_, other.buffer_);
     std::swap(data_, other.data_);
 }
 
@@ -0,0 +1,353 @@
+#include "Rendition.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace PixRaw {
+
+namespace {
+
+constexpr int kBandRows = 32;          // 每个行带的输出行数
+constexpr double kLanczosLobes = 3.0;
+constexpr double kPi = 3.14159265358979323846;
+
+double sinc(double x) {
+    if (std::abs(x) < 1e-8) {
+        return 1.0;
+    }
+    x *= kPi;
+    return std::sin(x) / x;
+}
+
+double lanczos(double x) {
+    x = std::abs(x);
+    return x < kLanczosLobes ? sinc(x) * sinc(x / kLanczosLobes) : 0.0;
+}
+
+/**
+ * 一维缩放的滤波器：每个输出位置对应连续的源区间 [first, first + count) 和归一化权重
+ */
+struct FilterTaps {
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int> offset;       // 在 weights 中的起点
+    std::vector<float> weights;
+
+    void build(int in_size, int out_size) {
+        first.resize(out_size);
+        count.resize(out_size);
+        offset.resize(out_size);
+        weights.clear();
+
+        const double scale = static_cast<double>(out_size) / in_size;
+        const double filter_scale = std::max(1.0, 1.0 / scale);  // 缩小时展宽核以抗混叠
+        const double support = kLanczosLobes * filter_scale;
+
+        std::vector<double> w;
+        for (int i = 0; i < out_size; ++i) {
+            const double center = (i + 0.5) / scale;  // 源坐标，像素中心位于 j + 0.5
+            int lo = std::max(0, static_cast<int>(std::floor(center - support)));
+            int hi = std::min(in_size, static_cast<int>(std::ceil(center + support)));
+
+            w.clear();
+            double sum = 0.0;
+            for (int j = lo; j < hi; ++j) {
+                double v = lanczos((j + 0.5 - center) / filter_scale);
+                w.push_back(v);
+                sum += v;
+            }
+            // 去掉两端的零权重
+            while (hi - lo > 1 && w.back() == 0.0) {
+                w.pop_back();
+                --hi;
+            }
+            size_t skip = 0;
+            while (hi - lo > 1 && w[skip] == 0.0) {
+                ++skip;
+                ++lo;
+            }
+
+            first[i] = lo;
+            count[i] = hi - lo;
+            offset[i] = static_cast<int>(weights.size());
+            // 边缘处源区间被截断，重新归一化
+            for (int k = 0; k < hi - lo; ++k) {
+                weights.push_back(static_cast<float>(sum != 0.0 ? w[skip + k] / sum : 1.0 / (hi - lo)));
+            }
+        }
+    }
+
+    // 输出区间 [o0, o1) 需要的源区间
+    void sourceRange(int o0, int o1, int& s0, int& s1) const {
+        s0 = first[o0];
+        s1 = first[o0] + count[o0];
+        for (int o = o0 + 1; o < o1; ++o) {
+            s0 = std::min(s0, first[o]);
+            s1 = std::max(s1, first[o] + count[o]);
+        }
+    }
+};
+
+// 归一化的一维高斯核，返回半径
+int gaussianKernel(float sigma, std::vector<float>& kernel) {
+    const int radius = std::max(1, std::min(static_cast<int>(std::ceil(3.0f * sigma)), 16));
+    kernel.assign(2 * radius + 1, 0.0f);
+    float sum = 0.0f;
+    for (int k = -radius; k <= radius; ++k) {
+        float v = std::exp(-0.5f * k * k / (sigma * sigma));
+        kernel[k + radius] = v;
+        sum += v;
+    }
+    for (float& v : kernel) {
+        v /= sum;
+    }
+    return radius;
+}
+
+inline float clamp01(float value) {
+    float v = value > 0.0f ? value : 0.0f;
+    return v < 1.0f ? v : 1.0f;
+}
+
+// 量化一行并按格式写出（与 PlanarImage::toInterleaved 的量化一致）
+void packRow(const float* r, const float* g, const float* b, int width, PixelFormat format, uint8_t* out) {
+    switch (format) {
+        case PixelFormat::RGB888:
+            for (int x = 0; x < width; ++x) {
+                out[x * 3 + 0] = static_cast<uint8_t>(clamp01(r[x]) * 255.0f + 0.5f);
+                out[x * 3 + 1] = static_cast<uint8_t>(clamp01(g[x]) * 255.0f + 0.5f);
+                out[x * 3 + 2] = static_cast<uint8_t>(clamp01(b[x]) * 255.0f + 0.5f);
+            }
+            break;
+        case PixelFormat::RGBA8888:
+            for (int x = 0; x < width; ++x) {
+                out[x * 4 + 0] = static_cast<uint8_t>(clamp01(r[x]) * 255.0f + 0.5f);
+                out[x * 4 + 1] = static_cast<uint8_t>(clamp01(g[x]) * 255.0f + 0.5f);
+                out[x * 4 + 2] = static_cast<uint8_t>(clamp01(b[x]) * 255.0f + 0.5f);
+                out[x * 4 + 3] = 255;
+            }
+            break;
+        case PixelFormat::RGB565:
+            for (int x = 0; x < width; ++x) {
+                uint16_t p = static_cast<uint16_t>((static_cast<int>(clamp01(r[x]) * 31.0f + 0.5f) << 11) |
+                                                   (static_cast<int>(clamp01(g[x]) * 63.0f + 0.5f) << 5) |
+                                                   static_cast<int>(clamp01(b[x]) * 31.0f + 0.5f));
+                out[x * 2 + 0] = static_cast<uint8_t>(p & 0xFF);
+                out[x * 2 + 1] = static_cast<uint8_t>(p >> 8);
+            }
+            break;
+    }
+}
+
+} // namespace
+
+void RenditionRenderer::outputSize(int width, int height, const RenditionSpec& spec, int& out_width,
+                                   int& out_height) {
+    double scale = 1.0;
+    if (spec.max_width > 0) {
+        scale = std::min(scale, static_cast<double>(spec.max_width) / width);
+    }
+    if (spec.max_height > 0) {
+        scale = std::min(scale, static_cast<double>(spec.max_height) / height);
+    }
+    out_width = std::max(1, static_cast<int>(std::lround(width * scale)));
+    out_height = std::max(1, static_cast<int>(std::lround(height * scale)));
+}
+
+RawImage RenditionRenderer::render(const PlanarImage& source, const RenditionSpec& spec,
+                                   const CancellationToken& token) {
+    if (!source.isValid()) {
+        return RawImage();
+    }
+
+    int out_width = 0;
+    int out_height = 0;
+    outputSize(source.width(), source.height(), spec, out_width, out_height);
+
+    RawImage result(out_width, out_height, spec.format);
+    if (!result.isValid()) {
+        return RawImage();
+    }
+
+    FilterTaps columns;
+    FilterTaps rows;
+    columns.build(source.width(), out_width);
+    rows.build(source.height(), out_height);
+
+    const bool sharpen = spec.sharpen_amount > 0.0f && spec.sharpen_radius >= 0.1f;
+    std::vector<float> gauss;
+    const int halo = sharpen ? gaussianKernel(spec.sharpen_radius, gauss) : 0;
+    const float amount = spec.sharpen_amount;
+    const float threshold = std::max(spec.sharpen_threshold, 0.0f);
+
+    const int bands = (out_height + kBandRows - 1) / kBandRows;
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        // 线程局部缓冲区：横向缩放后的源行、纵向缩放后的输出行（含锐化所需的上下各 halo 行）、亮度
+        std::vector<float> horizontal;
+        std::vector<float> band;
+        std::vector<float> luma;
+        std::vector<float> blurred;
+        std::vector<float> padded(static_cast<size_t>(out_width) + 2 * halo);
+        std::vector<float> detail(out_width);
+        std::vector<float> sharp(static_cast<size_t>(out_width) * PlanarImage::kChannels);
+
+#pragma omp for schedule(dynamic)
+        for (int index = 0; index < bands; ++index) {
+            const int oy0 = index * kBandRows;
+            const int oy1 = std::min(out_height, oy0 + kBandRows);
+            if (cancel.skip(oy0)) {
+                continue;
+            }
+
+            // 本行带（含 halo）对应的输出行和源行
+            const int r0 = std::max(0, oy0 - halo);
+            const int r1 = std::min(out_height, oy1 + halo);
+            int s0 = 0;
+            int s1 = 0;
+            rows.sourceRange(r0, r1, s0, s1);
+            const int src_rows = s1 - s0;
+            const int band_rows = r1 - r0;
+            const size_t plane_h = static_cast<size_t>(src_rows) * out_width;
+            const size_t plane_b = static_cast<size_t>(band_rows) * out_width;
+            horizontal.resize(plane_h * PlanarImage::kChannels);
+            band.resize(plane_b * PlanarImage::kChannels);
+
+            // 横向：每个需要的源行只读取一次
+            for (int c = 0; c < PlanarImage::kChannels; ++c) {
+                for (int sy = s0; sy < s1; ++sy) {
+                    const float* in = source.row(c, sy);
+                    float* out = horizontal.data() + c * plane_h + static_cast<size_t>(sy - s0) * out_width;
+                    for (int ox = 0; ox < out_width; ++ox) {
+                        const float* w = columns.weights.data() + columns.offset[ox];
+                        const float* px = in + columns.first[ox];
+                        const int n = columns.count[ox];
+                        float sum = 0.0f;
+#pragma omp simd reduction(+ : sum)
+                        for (int k = 0; k < n; ++k) {
+                            sum += px[k] * w[k];
+                        }
+                        out[ox] = sum;
+                    }
+                }
+            }
+
+            // 纵向：按输出行组合横向结果，沿行连续、可向量化
+            for (int c = 0; c < PlanarImage::kChannels; ++c) {
+                for (int oy = r0; oy < r1; ++oy) {
+                    float* out = band.data() + c * plane_b + static_cast<size_t>(oy - r0) * out_width;
+                    const float* w = rows.weights.data() + rows.offset[oy];
+                    const int n = rows.count[oy];
+                    const float* in = horizontal.data() + c * plane_h + static_cast<size_t>(rows.first[oy] - s0) * out_width;
+#pragma omp simd
+                    for (int x = 0; x < out_width; ++x) {
+                        out[x] = in[x] * w[0];
+                    }
+                    for (int k = 1; k < n; ++k) {
+                        const float* src = in + static_cast<size_t>(k) * out_width;
+                        const float wk = w[k];
+#pragma omp simd
+                        for (int x = 0; x < out_width; ++x) {
+                            out[x] += src[x] * wk;
+                        }
+                    }
+                }
+            }
+
+            if (sharpen) {
+                // 亮度及其横向高斯模糊（整个 band，含 halo 行）
+                luma.resize(plane_b);
+                blurred.resize(plane_b);
+                for (int i = 0; i < band_rows; ++i) {
+                    const size_t base = static_cast<size_t>(i) * out_width;
+                    const float* r = band.data() + base;
+                    const float* g = band.data() + plane_b + base;
+                    const float* b = band.data() + 2 * plane_b + base;
+                    float* l = luma.data() + base;
+#pragma omp simd
+                    for (int x = 0; x < out_width; ++x) {
+                        l[x] = 0.2126f * r[x] + 0.7152f * g[x] + 0.0722f * b[x];
+                    }
+
+                    // 两端复制边缘像素，内循环无需判断边界
+                    std::fill(padded.begin(), padded.begin() + halo, l[0]);
+                    std::copy(l, l + out_width, padded.begin() + halo);
+                    std::fill(padded.begin() + halo + out_width, padded.end(), l[out_width - 1]);
+                    float* h = blurred.data() + base;
+#pragma omp simd
+                    for (int x = 0; x < out_width; ++x) {
+                        float sum = 0.0f;
+                        for (int k = 0; k <= 2 * halo; ++k) {
+                            sum += padded[x + k] * gauss[k];
+                        }
+                        h[x] = sum;
+                    }
+                }
+            }
+
+            // 纵向模糊 + USM + 打包，只输出本行带自己的行
+            for (int oy = oy0; oy < oy1; ++oy) {
+                const size_t base = static_cast<size_t>(oy - r0) * out_width;
+                const float* r = band.data() + base;
+                const float* g = band.data() + plane_b + base;
+                const float* b = band.data() + 2 * plane_b + base;
+
+                if (sharpen) {
+                    const float* l = luma.data() + base;
+#pragma omp simd
+                    for (int x = 0; x < out_width; ++x) {
+                        detail[x] = 0.0f;
+                    }
+                    for (int k = -halo; k <= halo; ++k) {
+                        // 图像上下边缘复制边缘行（band 已包含 [r0, r1) 的所有可用行）
+                        const int row = std::min(std::max(oy + k, r0), r1 - 1);
+                        const float* h = blurred.data() + static_cast<size_t>(row - r0) * out_width;
+                        const float wk = gauss[k + halo];
+#pragma omp simd
+                        for (int x = 0; x < out_width; ++x) {
+                            detail[x] += h[x] * wk;
+                        }
+                    }
+
+                    float* sr = sharp.data();
+                    float* sg = sr + out_width;
+                    float* sb = sg + out_width;
+#pragma omp simd
+                    for (int x = 0; x < out_width; ++x) {
+                        float d = l[x] - detail[x];
+                        d = std::abs(d) >= threshold ? d * amount : 0.0f;
+                        sr[x] = r[x] + d;
+                        sg[x] = g[x] + d;
+                        sb[x] = b[x] + d;
+                    }
+                    packRow(sr, sg, sb, out_width, spec.format, result.row(oy));
+                } else {
+                    packRow(r, g, b, out_width, spec.format, result.row(oy));
+                }
+            }
+        }
+    }
+
+    if (cancel.stopped()) {
+        return RawImage();
+    }
+    return result;
+}
+
+std::vector<RawImage> RenditionRenderer::render(const PlanarImage& source, const std::vector<RenditionSpec>& specs,
+                                                const CancellationToken& token) {
+    std::vector<RawImage> results;
+    results.reserve(specs.size());
+    for (const RenditionSpec& spec : specs) {
+        RawImage image = render(source, spec, token);
+        if (token.isCancelled()) {
+            return std::vector<RawImage>();
+        }
+        results.push_back(std::move(image));
+    }
+    return results;
+}
+
+} // namespace PixRaw
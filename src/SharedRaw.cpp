@@ -0,0 +1,361 @@
+#include "SharedRaw.h"
+#include "ImageAdjuster.h"
+#include "LibRawDecode.h"
+#include "MemoryBudget.h"
+#include "ParallelLibRaw.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+
+namespace PixRaw {
+
+// === SharedRaw 实现 ===
+
+namespace {
+
+// 等待其他请求解码时轮询取消令牌的间隔（截止时间不会触发监听）
+constexpr std::chrono::milliseconds kWaitPoll(10);
+
+} // namespace
+
+class SharedRaw::Impl {
+public:
+    Impl() : libraw_(std::make_unique<ParallelLibRaw>()) {
+        // 进度回调在 dcraw_process() 各阶段之间检查正在解码的请求的令牌
+        libraw_->set_progress_handler(&Impl::progressCallback, this);
+    }
+
+    // 打开后立即解包，之后 LibRaw 只用于 dcraw_process()
+    bool unpack(int open_result, std::string& error) {
+        if (open_result != LIBRAW_SUCCESS) {
+            error = "Failed to open file: " + std::string(libraw_strerror(open_result));
+            return false;
+        }
+
+        int ret = libraw_->unpack();
+        if (ret != LIBRAW_SUCCESS) {
+            error = "Unpack failed: " + std::string(libraw_strerror(ret));
+            return false;
+        }
+        unpacked_ = true;
+
+        metadata_ = readMetadata(*libraw_);
+        const libraw_image_sizes_t& sizes = libraw_->imgdata.sizes;
+        bool rotated = (sizes.flip & 4) != 0;
+        width_ = rotated ? sizes.height : sizes.width;
+        height_ = rotated ? sizes.width : sizes.height;
+        memory_.settle(retainedBytes());
+        return true;
+    }
+
+    LinearImage linearImage(bool half_size, std::string* error, const CancellationToken& token) {
+        Tier& tier = tiers_[half_size ? 1 : 0];
+
+        // LibRaw 实例同一时间只能处理一个请求；已缓存的档位不受影响，
+        // 等待其他请求解码期间可以取消
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (true) {
+                if (tier.image.image || tier.failed) {
+                    if (error) *error = tier.error;
+                    return tier.image;
+                }
+                if (!decoding_) {
+                    break;
+                }
+                if (token.isCancelled()) {
+                    if (error) *error = cancelledMessage(token);
+                    return LinearImage();
+                }
+                if (token.canBeCancelled()) {
+                    decoded_.wait_for(lock, kWaitPoll);
+                } else {
+                    decoded_.wait(lock);
+                }
+            }
+            decoding_ = true;
+        }
+
+        std::string message;
+        LinearImage result;
+        const bool done = decode(half_size, token, result, message);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoding_ = false;
+        decoded_.notify_all();
+        if (!done) {
+            // 取消不缓存结果，之后的请求重新解码
+            if (error) *error = message;
+            return LinearImage();
+        }
+        if (result.image) {
+            tier.image = result;
+        } else {
+            tier.failed = true;
+            tier.error = message;
+        }
+        if (error) *error = tier.error;
+        return tier.image;
+    }
+
+    struct Tier {
+        LinearImage image;
+        bool failed = false;
+        std::string error;
+    };
+
+    std::unique_ptr<ParallelLibRaw> libraw_;
+    std::string path_;                  // 取消后重新打开用：文件路径，或
+    const void* buffer_ = nullptr;      // 调用方的缓冲区
+    size_t buffer_size_ = 0;
+    RawMetadata metadata_;
+    int width_ = 0;
+    int height_ = 0;
+
+private:
+    // 由 decoding_ 串行化的一次解码；返回 false 表示被取消（不缓存），
+    // 否则 result.image 为空时 error 为失败原因
+    bool decode(bool half_size, const CancellationToken& token, LinearImage& result, std::string& error) {
+        // RAW 数据已保留；工作图像、线性缓存和输出拷贝在调用期间申请
+        const MemoryEstimate estimate = MemoryBudget::estimateDecode(metadata_, half_size);
+        uint64_t bytes = retainedBytes() + estimate.processed_bytes + estimate.cache_bytes + estimate.transient_bytes;
+        if (!unpacked_) {
+            bytes += estimate.raw_bytes;
+        }
+        if (!memory_.acquire("linearImage", bytes, 0, token)) {
+            error = cancelledMessage(token);
+            return false;
+        }
+
+        // cancel() 转发给 LibRaw 的逐行循环，截止时间在进度回调中轮询
+        decode_token_ = token;
+        libraw_->clearCancelFlag();
+        ParallelLibRaw* libraw = libraw_.get();
+        const int listener = token.addListener([libraw] { libraw->setCancelFlag(); });
+
+        bool done = true;
+        int ret = LIBRAW_SUCCESS;
+        if (!unpacked_) {
+            ret = reopen();
+            unpacked_ = ret == LIBRAW_SUCCESS;
+            if (ret != LIBRAW_SUCCESS && ret != LIBRAW_CANCELLED_BY_CALLBACK) {
+                error = "Unpack failed: " + std::string(libraw_strerror(ret));
+            }
+        }
+        if (unpacked_) {
+            StatsRecorder stats;  // 未启用，不记录
+            auto image = std::make_shared<HalfPlanarImage>();
+            ret = decodeLinear(*libraw_, half_size, stats, *image, result.camera, error);
+            if (ret == LIBRAW_SUCCESS) {
+                result.image = std::move(image);
+            }
+        }
+        if (ret == LIBRAW_CANCELLED_BY_CALLBACK) {
+            // LibRaw 在回调取消后 recycle()，RAW 数据需要在下次解码前重新打开并解包
+            unpacked_ = false;
+            error = cancelledMessage(token);
+            done = false;
+        }
+
+        token.removeListener(listener);
+        decode_token_ = CancellationToken();
+        memory_.settle(retainedBytes());
+        return done;
+    }
+
+    int reopen() {
+        int ret = path_.empty() ? libraw_->open_buffer(buffer_, buffer_size_) : libraw_->open_file(path_.c_str());
+        return ret == LIBRAW_SUCCESS ? libraw_->unpack() : ret;
+    }
+
+    // RAW 数据与已缓存的档位（由解码中的请求调用，或在打开时调用）
+    uint64_t retainedBytes() const {
+        uint64_t bytes = 0;
+        if (unpacked_) {
+            const libraw_image_sizes_t& sizes = libraw_->imgdata.rawdata.sizes;
+            bytes += static_cast<uint64_t>(sizes.raw_pitch) * sizes.raw_height;
+        }
+        for (const Tier& tier : tiers_) {
+            if (tier.image.image) {
+                bytes += tier.image.image->byteSize();
+            }
+        }
+        return bytes;
+    }
+
+    static std::string cancelledMessage(const CancellationToken& token) {
+        return token.status() == DecodeStatus::DeadlineExceeded ? "Deadline exceeded" : "Cancelled";
+    }
+
+    static int progressCallback(void* data, enum LibRaw_progress, int, int) {
+        const Impl* impl = static_cast<const Impl*>(data);
+        return impl->decode_token_.isCancelled() ? 1 : 0;
+    }
+
+    bool unpacked_ = false;
+    CancellationToken decode_token_;    // 正在解码的请求的令牌（只由解码线程读写）
+    MemoryReservation memory_;          // 在进程级内存预算中的预留（RAW 数据与缓存的档位）
+
+    std::mutex mutex_;                  // 保护 tiers_ 和 decoding_
+    std::condition_variable decoded_;   // 一次解码结束时通知
+    bool decoding_ = false;             // 是否有请求正在使用 LibRaw
+    Tier tiers_[2];                     // 0 = 全尺寸，1 = 半尺寸
+};
+
+SharedRaw::SharedRaw() : impl_(std::make_unique<Impl>()) {}
+
+SharedRaw::~SharedRaw() = default;
+
+std::shared_ptr<const SharedRaw> SharedRaw::open(const std::string& filepath, std::string* error) {
+    std::shared_ptr<SharedRaw> raw(new SharedRaw());
+    std::string message;
+    raw->impl_->path_ = filepath;
+    if (!raw->impl_->unpack(raw->impl_->libraw_->open_file(filepath.c_str()), message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return raw;
+}
+
+std::shared_ptr<const SharedRaw> SharedRaw::openBuffer(const void* data, size_t size, std::string* error) {
+    if (!data || size == 0) {
+        if (error) *error = "Invalid buffer";
+        return nullptr;
+    }
+
+    std::shared_ptr<SharedRaw> raw(new SharedRaw());
+    std::string message;
+    raw->impl_->buffer_ = data;
+    raw->impl_->buffer_size_ = size;
+    if (!raw->impl_->unpack(raw->impl_->libraw_->open_buffer(data, size), message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return raw;
+}
+
+const RawMetadata& SharedRaw::metadata() const { return impl_->metadata_; }
+
+int SharedRaw::width() const { return impl_->width_; }
+
+int SharedRaw::height() const { return impl_->height_; }
+
+SharedRaw::LinearImage SharedRaw::linearImage(bool half_size, std::string* error, const CancellationToken& token) const {
+    return impl_->linearImage(half_size, error, token);
+}
+
+// === RenderContext 实现 ===
+
+RenderContext::RenderContext() = default;
+
+RenderContext::~RenderContext() = default;
+
+RawImage RenderContext::render(const SharedRaw& raw, const RenderRequest& request, const CancellationToken& token) {
+    status_ = DecodeStatus::Success;
+    error_.clear();
+    statistics_ = ImageStatistics();
+
+    // 区域（全尺寸坐标）
+    const int full_width = raw.width();
+    const int full_height = raw.height();
+    const int x = request.x;
+    const int y = request.y;
+    const int width = request.width > 0 ? request.width : full_width - x;
+    const int height = request.height > 0 ? request.height : full_height - y;
+    if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > full_width || y + height > full_height) {
+        fail("Invalid region");
+        return RawImage();
+    }
+
+    // 输出尺寸：保持宽高比，不放大
+    double scale = 1.0;
+    if (request.max_width > 0) {
+        scale = std::min(scale, static_cast<double>(request.max_width) / width);
+    }
+    if (request.max_height > 0) {
+        scale = std::min(scale, static_cast<double>(request.max_height) / height);
+    }
+    const int out_width = std::max(1, static_cast<int>(std::lround(width * scale)));
+    const int out_height = std::max(1, static_cast<int>(std::lround(height * scale)));
+
+    if (cancelled(token)) {
+        return RawImage();
+    }
+
+    // 输出不超过全尺寸一半时，半尺寸档已有足够的分辨率
+    std::string error;
+    SharedRaw::LinearImage linear = raw.linearImage(scale <= 0.5, &error, token);
+    if (!linear.image) {
+        if (!cancelled(token)) {
+            fail(error);
+        }
+        return RawImage();
+    }
+    if (cancelled(token)) {
+        return RawImage();
+    }
+
+    // 区域映射到该档的坐标
+    const HalfPlanarImage& source = *linear.image;
+    const double sx = static_cast<double>(source.width()) / full_width;
+    const double sy = static_cast<double>(source.height()) / full_height;
+    const int tx = std::min(static_cast<int>(x * sx), source.width() - 1);
+    const int ty = std::min(static_cast<int>(y * sy), source.height() - 1);
+    const int tw = std::max(1, std::min(source.width() - tx, static_cast<int>(std::lround(width * sx))));
+    const int th = std::max(1, std::min(source.height() - ty, static_cast<int>(std::lround(height * sy))));
+
+    if (working_.width() != out_width || working_.height() != out_height) {
+        working_ = PlanarImage(out_width, out_height);
+        if (!working_.isValid()) {
+            fail("Failed to allocate working image");
+            return RawImage();
+        }
+    }
+    source.resampleInto(working_, tx, ty, tw, th, token);
+    if (cancelled(token)) {
+        return RawImage();
+    }
+
+    // 曝光/白平衡/色温/色调在线性相机空间处理，与相机矩阵、输出色彩空间合并到同一张 LUT
+    ColorSettings color = ColorSettings::sceneReferred(request.adjustments, request.output_space);
+    ColorLut3D::cached(linear.camera, color)->apply(working_, working_, token);
+    if (cancelled(token)) {
+        return RawImage();
+    }
+
+    RawAdjustments display = request.adjustments.displayReferred();
+    if (display.hasAdjustments()) {
+        ImageAdjuster::applyAdjustments(working_, display, token);
+        if (cancelled(token)) {
+            return RawImage();
+        }
+    }
+
+    RawImage result = working_.toInterleaved(request.format, &statistics_, request.statistics, token);
+    if (!result.isValid()) {
+        if (!cancelled(token)) {
+            fail("Failed to create output image");
+        }
+        return RawImage();
+    }
+    return result;
+}
+
+void RenderContext::fail(const std::string& message) {
+    error_ = message;
+    status_ = DecodeStatus::Failed;
+}
+
+bool RenderContext::cancelled(const CancellationToken& token) {
+    DecodeStatus status = token.status();
+    if (status == DecodeStatus::Success) {
+        return false;
+    }
+    status_ = status;
+    error_ = (status == DecodeStatus::DeadlineExceeded) ? "Deadline exceeded" : "Cancelled";
+    return true;
+}
+
+} // namespace PixRaw
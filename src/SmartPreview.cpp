@@ -0,0 +1,790 @@
+#include "SmartPreview.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace PixRaw {
+
+namespace {
+
+const char kMagic[8] = {'P', 'I', 'X', 'R', 'A', 'W', 'S', 'P'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 64;
+constexpr int kBandRows = RowBandCancellation::kRowBand;
+constexpr int kMaxDimension = 65535;     // 与 LibRaw 的 16 位尺寸一致
+
+// 像素编码
+constexpr uint32_t kEncodingHalf = 0;    // 半精度位模式，无损
+constexpr uint32_t kEncodingSqrt12 = 1;  // sqrt(v) 量化到 12 位，有损
+
+constexpr int kLossyLevels = 4095;
+
+// Rice 编码：每 32 个残差一个参数 k，商达到 kEscape 时直接写 16 位原值
+constexpr int kBlockSize = 32;
+constexpr int kParameterBits = 4;
+constexpr uint32_t kEscape = 24;
+
+// n 个样本编码后的最小字节数：每个样本至少 1 位，每块另有 kParameterBits 位参数
+uint64_t minimumStreamBytes(uint64_t samples) {
+    const uint64_t blocks = (samples + kBlockSize - 1) / kBlockSize;
+    return (samples + blocks * kParameterBits + 7) / 8;
+}
+
+// === 字节读写（小端） ===
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) out_.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) out_.push_back(static_cast<uint8_t>(v >> (i * 8)));
+    }
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void f32(float v) {
+        uint32_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u64(bits);
+    }
+    void str(const std::string& s) {
+        u32(static_cast<uint32_t>(s.size()));
+        out_.insert(out_.end(), s.begin(), s.end());
+    }
+    void align(size_t alignment) {
+        while (out_.size() % alignment != 0) out_.push_back(0);
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+};
+
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        if (need(4)) {
+            for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(data_[pos_ + i]) << (i * 8);
+            pos_ += 4;
+        }
+        return v;
+    }
+    uint64_t u64() {
+        uint64_t v = 0;
+        if (need(8)) {
+            for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(data_[pos_ + i]) << (i * 8);
+            pos_ += 8;
+        }
+        return v;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    float f32() {
+        uint32_t bits = u32();
+        float v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    double f64() {
+        uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string str() {
+        uint32_t length = u32();
+        if (!need(length)) return std::string();
+        std::string s(reinterpret_cast<const char*>(data_ + pos_), length);
+        pos_ += length;
+        return s;
+    }
+
+    bool ok() const { return ok_; }
+
+private:
+    bool need(size_t n) {
+        if (!ok_ || size_ - pos_ < n) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+// === 比特读写（高位在前） ===
+
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    // count <= 32
+    void put(uint32_t bits, int count) {
+        acc_ = (acc_ << count) | bits;
+        pending_ += count;
+        while (pending_ >= 8) {
+            pending_ -= 8;
+            out_.push_back(static_cast<uint8_t>(acc_ >> pending_));
+        }
+    }
+
+    void flush() {
+        if (pending_ > 0) {
+            out_.push_back(static_cast<uint8_t>(acc_ << (8 - pending_)));
+            pending_ = 0;
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_ = 0;
+    int pending_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+    // count <= 32
+    uint32_t get(int count) {
+        if (count == 0) return 0;
+        refill();
+        uint32_t v = static_cast<uint32_t>(buffer_ >> (64 - count));
+        buffer_ <<= count;
+        available_ -= count;
+        return v;
+    }
+
+    // 一元编码的商：连续的 1，遇到 0 或达到 limit 停止
+    uint32_t ones(uint32_t limit) {
+        uint32_t q = 0;
+        for (;;) {
+            refill();
+            while (available_ > 0 && (buffer_ >> 63) != 0) {
+                buffer_ <<= 1;
+                --available_;
+                if (++q == limit) return q;
+            }
+            if (available_ > 0) {
+                buffer_ <<= 1;
+                --available_;
+                return q;
+            }
+        }
+    }
+
+    // 读取超出数据末尾的字节数（正常结束时不超过一个填充字节）
+    bool overrun() const { return padding_ > 8; }
+
+private:
+    void refill() {
+        while (available_ <= 56) {
+            uint64_t byte = 0;
+            if (p_ < end_) {
+                byte = *p_++;
+            } else {
+                ++padding_;
+            }
+            buffer_ |= byte << (56 - available_);
+            available_ += 8;
+        }
+    }
+
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t buffer_ = 0;
+    int available_ = 0;
+    size_t padding_ = 0;
+};
+
+// === 预测与残差 ===
+
+// MED（LOCO-I）预测：a = 左，b = 上，c = 左上；行带首行只用左邻
+inline int predict(const uint16_t* cur, const uint16_t* prev, int x) {
+    if (!prev) {
+        return x > 0 ? cur[x - 1] : 0;
+    }
+    if (x == 0) {
+        return prev[0];
+    }
+    int a = cur[x - 1];
+    int b = prev[x];
+    int c = prev[x - 1];
+    if (c >= std::max(a, b)) return std::min(a, b);
+    if (c <= std::min(a, b)) return std::max(a, b);
+    return a + b - c;
+}
+
+inline uint16_t zigzag(int sample, int prediction) {
+    int16_t d = static_cast<int16_t>(static_cast<uint16_t>(sample - prediction));
+    return static_cast<uint16_t>((static_cast<uint16_t>(d) << 1) ^ static_cast<uint16_t>(d >> 15));
+}
+
+inline uint16_t unzigzag(uint16_t code, int prediction) {
+    int d = (code >> 1) ^ -static_cast<int>(code & 1);
+    return static_cast<uint16_t>(prediction + d);
+}
+
+// 行带内每个通道是一段独立的码流
+class BandEncoder {
+public:
+    explicit BandEncoder(std::vector<uint8_t>& out) : bits_(out) {}
+
+    void add(uint16_t residual) {
+        block_[count_++] = residual;
+        if (count_ == kBlockSize) flushBlock();
+    }
+
+    void finish() {
+        if (count_ > 0) flushBlock();
+        bits_.flush();
+    }
+
+private:
+    void flushBlock() {
+        // k 取约 log2(平均残差)
+        uint32_t sum = 0;
+        for (int i = 0; i < count_; ++i) sum += block_[i];
+        uint32_t k = 0;
+        while (k < 15 && (static_cast<uint32_t>(count_) << (k + 1)) <= sum) ++k;
+        bits_.put(k, kParameterBits);
+
+        for (int i = 0; i < count_; ++i) {
+            uint32_t q = block_[i] >> k;
+            if (q >= kEscape) {
+                bits_.put((1u << kEscape) - 1, kEscape);
+                bits_.put(block_[i], 16);
+            } else {
+                bits_.put((1u << (q + 1)) - 2, static_cast<int>(q) + 1);
+                if (k > 0) bits_.put(block_[i] & ((1u << k) - 1), static_cast<int>(k));
+            }
+        }
+        count_ = 0;
+    }
+
+    BitWriter bits_;
+    uint16_t block_[kBlockSize];
+    int count_ = 0;
+};
+
+class BandDecoder {
+public:
+    BandDecoder(const uint8_t* data, size_t size) : bits_(data, size) {}
+
+    uint16_t next() {
+        if (remaining_ == 0) {
+            k_ = bits_.get(kParameterBits);
+            remaining_ = kBlockSize;
+        }
+        --remaining_;
+        uint32_t q = bits_.ones(kEscape);
+        if (q == kEscape) {
+            return static_cast<uint16_t>(bits_.get(16));
+        }
+        return static_cast<uint16_t>((q << k_) | bits_.get(static_cast<int>(k_)));
+    }
+
+    bool overrun() const { return bits_.overrun(); }
+
+private:
+    BitReader bits_;
+    uint32_t k_ = 0;
+    int remaining_ = 0;
+};
+
+// === 元数据 ===
+
+void writeMetadata(ByteWriter& w, const RawMetadata& m, const CameraColor& camera) {
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            w.f32(camera.rgb_cam[i][j]);
+    for (int c = 0; c < 3; ++c) w.f32(camera.cam_mul[c]);
+
+    w.str(m.camera_make);
+    w.str(m.camera_model);
+    w.str(m.software);
+    w.str(m.lens_model);
+    w.i32(m.image_width);
+    w.i32(m.image_height);
+    w.i32(m.raw_width);
+    w.i32(m.raw_height);
+    w.f64(m.iso);
+    w.f64(m.shutter_speed);
+    w.f64(m.aperture);
+    w.f64(m.focal_length);
+    w.u64(static_cast<uint64_t>(m.timestamp));
+    w.f32(m.wb_red);
+    w.f32(m.wb_green);
+    w.f32(m.wb_blue);
+    w.i32(m.orientation);
+    w.i32(m.is_raw ? 1 : 0);
+}
+
+bool readMetadata(ByteReader& r, RawMetadata& m, CameraColor& camera) {
+    for (int i = 0; i < 3; ++i)
+        for (int j = 0; j < 3; ++j)
+            camera.rgb_cam[i][j] = r.f32();
+    for (int c = 0; c < 3; ++c) camera.cam_mul[c] = r.f32();
+
+    m.camera_make = r.str();
+    m.camera_model = r.str();
+    m.software = r.str();
+    m.lens_model = r.str();
+    m.image_width = r.i32();
+    m.image_height = r.i32();
+    m.raw_width = r.i32();
+    m.raw_height = r.i32();
+    m.iso = r.f64();
+    m.shutter_speed = r.f64();
+    m.aperture = r.f64();
+    m.focal_length = r.f64();
+    m.timestamp = static_cast<int64_t>(r.u64());
+    m.wb_red = r.f32();
+    m.wb_green = r.f32();
+    m.wb_blue = r.f32();
+    m.orientation = r.i32();
+    m.is_raw = r.i32() != 0;
+    return r.ok();
+}
+
+// === 文件映射 ===
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { unmap(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool map(const std::string& filepath, std::string& error) {
+#ifdef _WIN32
+        file_ = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            error = "Failed to open file";
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+            error = "Failed to read file size";
+            return false;
+        }
+        mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_) {
+            error = "Failed to map file";
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        size_ = static_cast<size_t>(size.QuadPart);
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "Failed to open file";
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            error = "Failed to read file size";
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // 映射在关闭描述符后仍然有效
+        if (p == MAP_FAILED) {
+            size_ = 0;
+            error = "Failed to map file";
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(p);
+        // 解码会顺序读完整个文件
+        posix_madvise(p, size_, POSIX_MADV_WILLNEED);
+#endif
+        if (!data_) {
+            error = "Failed to map file";
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void unmap() {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#endif
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+// === SmartPreview 实现 ===
+
+class SmartPreview::Impl {
+public:
+    // 解析文件头、元数据和行带索引；像素数据在 decode() 时才读取
+    bool parse(const uint8_t* data, size_t size, std::string& error) {
+        if (!isSmartPreview(data, size) || size < kHeaderSize) {
+            error = "Not a smart preview";
+            return false;
+        }
+
+        ByteReader header(data + sizeof(kMagic), kHeaderSize - sizeof(kMagic));
+        uint32_t version = header.u32();
+        encoding_ = header.u32();
+        width_ = static_cast<int>(header.u32());
+        height_ = static_cast<int>(header.u32());
+        uint32_t band_rows = header.u32();
+        uint32_t band_count = header.u32();
+        uint64_t metadata_offset = header.u64();
+        uint64_t metadata_size = header.u64();
+        uint64_t index_offset = header.u64();
+        uint64_t file_size = header.u64();
+
+        if (version != kVersion) {
+            error = "Unsupported smart preview version";
+            return false;
+        }
+        if (file_size != size) {
+            error = "Truncated smart preview";
+            return false;
+        }
+        if ((encoding_ != kEncodingHalf && encoding_ != kEncodingSqrt12) || width_ <= 0 || height_ <= 0 ||
+            width_ > kMaxDimension || height_ > kMaxDimension || band_rows != static_cast<uint32_t>(kBandRows) ||
+            band_count != static_cast<uint32_t>((height_ + kBandRows - 1) / kBandRows)) {
+            error = "Invalid smart preview header";
+            return false;
+        }
+
+        const uint64_t index_size = static_cast<uint64_t>(band_count) * HalfPlanarImage::kChannels * 16;
+        if (metadata_offset > size || metadata_size > size - metadata_offset ||
+            index_offset > size || index_size > size - index_offset) {
+            error = "Invalid smart preview layout";
+            return false;
+        }
+
+        ByteReader meta(data + metadata_offset, static_cast<size_t>(metadata_size));
+        if (!readMetadata(meta, metadata_, camera_)) {
+            error = "Invalid smart preview metadata";
+            return false;
+        }
+
+        // 每个流至少要能容纳其行带的全部样本，尺寸与文件大小不符时在分配图像之前拒绝
+        ByteReader index(data + index_offset, static_cast<size_t>(index_size));
+        streams_.resize(static_cast<size_t>(band_count) * HalfPlanarImage::kChannels);
+        for (size_t s = 0; s < streams_.size(); ++s) {
+            Stream& stream = streams_[s];
+            uint64_t offset = index.u64();
+            uint64_t length = index.u64();
+            const int band = static_cast<int>(s / HalfPlanarImage::kChannels);
+            const int rows = std::min(kBandRows, height_ - band * kBandRows);
+            if (offset > size || length > size - offset ||
+                length < minimumStreamBytes(static_cast<uint64_t>(rows) * width_)) {
+                error = "Invalid smart preview layout";
+                return false;
+            }
+            stream.data = data + offset;
+            stream.size = static_cast<size_t>(length);
+        }
+
+        data_ = data;
+        return true;
+    }
+
+    struct Stream {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    MappedFile file_;              // open() 时持有映射，openBuffer() 时不使用
+    const uint8_t* data_ = nullptr;
+    RawMetadata metadata_;
+    CameraColor camera_;
+    uint32_t encoding_ = kEncodingHalf;
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<Stream> streams_;  // 按 (行带, 通道) 排列
+};
+
+SmartPreview::SmartPreview() : impl_(std::make_unique<Impl>()) {}
+
+SmartPreview::~SmartPreview() = default;
+
+bool SmartPreview::isSmartPreview(const void* data, size_t size) {
+    return data && size >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool SmartPreview::isSmartPreviewFile(const std::string& filepath) {
+    std::ifstream in(filepath, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && isSmartPreview(magic, sizeof(magic));
+}
+
+std::vector<uint8_t> SmartPreview::encode(const HalfPlanarImage& image, const RawMetadata& metadata,
+                                          const CameraColor& camera, bool lossy, const CancellationToken& token) {
+    std::vector<uint8_t> out;
+    if (!image.isValid()) {
+        return out;
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    const int band_count = (height + kBandRows - 1) / kBandRows;
+    const int stream_count = band_count * HalfPlanarImage::kChannels;
+
+    // 有损编码：半精度 -> sqrt 域 12 位
+    std::vector<uint16_t> to_code;
+    if (lossy) {
+        to_code.resize(65536);
+        for (uint32_t h = 0; h < 65536; ++h) {
+            float v = std::min(std::max(HalfPlanarImage::toFloat(static_cast<uint16_t>(h)), 0.0f), 1.0f);
+            to_code[h] = static_cast<uint16_t>(std::lround(std::sqrt(v) * kLossyLevels));
+        }
+    }
+
+    // 各码流独立压缩
+    std::vector<std::vector<uint8_t>> streams(stream_count);
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        std::vector<uint16_t> rows(static_cast<size_t>(width) * 2);
+
+#pragma omp for schedule(dynamic)
+        for (int s = 0; s < stream_count; ++s) {
+            const int band = s / HalfPlanarImage::kChannels;
+            const int channel = s % HalfPlanarImage::kChannels;
+            if (cancel.skip(band * kBandRows)) {
+                continue;
+            }
+
+            BandEncoder encoder(streams[s]);
+            uint16_t* cur = rows.data();
+            uint16_t* prev = nullptr;
+            const int y_end = std::min(height, (band + 1) * kBandRows);
+            for (int y = band * kBandRows; y < y_end; ++y) {
+                const uint16_t* src = image.row(channel, y);
+                if (lossy) {
+                    for (int x = 0; x < width; ++x) cur[x] = to_code[src[x]];
+                } else {
+                    std::memcpy(cur, src, static_cast<size_t>(width) * sizeof(uint16_t));
+                }
+                for (int x = 0; x < width; ++x) {
+                    encoder.add(zigzag(cur[x], predict(cur, prev, x)));
+                }
+                prev = cur;
+                cur = (cur == rows.data()) ? rows.data() + width : rows.data();
+            }
+            encoder.finish();
+        }
+    }
+
+    if (cancel.stopped()) {
+        return out;
+    }
+
+    // 文件头
+    ByteWriter w(out);
+    out.insert(out.end(), kMagic, kMagic + sizeof(kMagic));
+    w.u32(kVersion);
+    w.u32(lossy ? kEncodingSqrt12 : kEncodingHalf);
+    w.u32(static_cast<uint32_t>(width));
+    w.u32(static_cast<uint32_t>(height));
+    w.u32(static_cast<uint32_t>(kBandRows));
+    w.u32(static_cast<uint32_t>(band_count));
+    const size_t layout_at = out.size();
+    w.u64(0);  // metadata_offset
+    w.u64(0);  // metadata_size
+    w.u64(0);  // index_offset
+    w.u64(0);  // file_size
+
+    // 元数据
+    const uint64_t metadata_offset = out.size();
+    writeMetadata(w, metadata, camera);
+    const uint64_t metadata_size = out.size() - metadata_offset;
+    w.align(8);
+
+    // 行带索引（偏移在数据写入后回填）
+    const uint64_t index_offset = out.size();
+    out.resize(out.size() + static_cast<size_t>(stream_count) * 16);
+
+    std::vector<uint8_t> index;
+    ByteWriter iw(index);
+    for (const std::vector<uint8_t>& stream : streams) {
+        w.align(8);
+        iw.u64(out.size());
+        iw.u64(stream.size());
+        out.insert(out.end(), stream.begin(), stream.end());
+    }
+    std::memcpy(out.data() + index_offset, index.data(), index.size());
+
+    std::vector<uint8_t> layout;
+    ByteWriter lw(layout);
+    lw.u64(metadata_offset);
+    lw.u64(metadata_size);
+    lw.u64(index_offset);
+    lw.u64(out.size());
+    std::memcpy(out.data() + layout_at, layout.data(), layout.size());
+    return out;
+}
+
+bool SmartPreview::write(const std::string& filepath, const HalfPlanarImage& image, const RawMetadata& metadata,
+                         const CameraColor& camera, bool lossy, std::string* error, const CancellationToken& token) {
+    std::vector<uint8_t> data = encode(image, metadata, camera, lossy, token);
+    if (data.empty()) {
+        if (error) *error = token.isCancelled() ? "Cancelled" : "Failed to encode smart preview";
+        return false;
+    }
+
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()))) {
+        if (error) *error = "Failed to write file: " + filepath;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<SmartPreview> SmartPreview::open(const std::string& filepath, std::string* error) {
+    std::unique_ptr<SmartPreview> preview(new SmartPreview());
+    std::string message;
+    MappedFile& file = preview->impl_->file_;
+    if (!file.map(filepath, message) || !preview->impl_->parse(file.data(), file.size(), message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return preview;
+}
+
+std::unique_ptr<SmartPreview> SmartPreview::openBuffer(const void* data, size_t size, std::string* error) {
+    std::unique_ptr<SmartPreview> preview(new SmartPreview());
+    std::string message;
+    if (!preview->impl_->parse(static_cast<const uint8_t*>(data), size, message)) {
+        if (error) *error = message;
+        return nullptr;
+    }
+    return preview;
+}
+
+const RawMetadata& SmartPreview::metadata() const { return impl_->metadata_; }
+
+const CameraColor& SmartPreview::camera() const { return impl_->camera_; }
+
+int SmartPreview::width() const { return impl_->width_; }
+
+int SmartPreview::height() const { return impl_->height_; }
+
+bool SmartPreview::isLossy() const { return impl_->encoding_ == kEncodingSqrt12; }
+
+HalfPlanarImage SmartPreview::decode(const CancellationToken& token, std::string* error) const {
+    const int width = impl_->width_;
+    const int height = impl_->height_;
+    HalfPlanarImage image(width, height);
+    if (!image.isValid()) {
+        if (error) *error = "Failed to allocate image";
+        return HalfPlanarImage();
+    }
+
+    // 有损编码：12 位 sqrt 码 -> 半精度
+    const bool lossy = isLossy();
+    std::vector<uint16_t> from_code;
+    if (lossy) {
+        from_code.resize(kLossyLevels + 1);
+        for (int i = 0; i <= kLossyLevels; ++i) {
+            float v = static_cast<float>(i) / kLossyLevels;
+            from_code[i] = HalfPlanarImage::toHalf(v * v);
+        }
+    }
+
+    const int stream_count = static_cast<int>(impl_->streams_.size());
+    std::atomic<bool> corrupt{false};
+    RowBandCancellation cancel(token);
+
+#pragma omp parallel
+    {
+        std::vector<uint16_t> rows(static_cast<size_t>(width) * 2);
+
+#pragma omp for schedule(dynamic)
+        for (int s = 0; s < stream_count; ++s) {
+            const int band = s / HalfPlanarImage::kChannels;
+            const int channel = s % HalfPlanarImage::kChannels;
+            if (cancel.skip(band * kBandRows)) {
+                continue;
+            }
+
+            const Impl::Stream& stream = impl_->streams_[s];
+            BandDecoder decoder(stream.data, stream.size);
+            uint16_t* cur = rows.data();
+            uint16_t* prev = nullptr;
+            const int y_end = std::min(height, (band + 1) * kBandRows);
+            for (int y = band * kBandRows; y < y_end; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    cur[x] = unzigzag(decoder.next(), predict(cur, prev, x));
+                }
+                uint16_t* dst = image.row(channel, y);
+                if (lossy) {
+                    for (int x = 0; x < width; ++x) dst[x] = from_code[std::min<int>(cur[x], kLossyLevels)];
+                } else {
+                    std::memcpy(dst, cur, static_cast<size_t>(width) * sizeof(uint16_t));
+                }
+                prev = cur;
+                cur = (cur == rows.data()) ? rows.data() + width : rows.data();
+            }
+            if (decoder.overrun()) {
+                corrupt.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (cancel.stopped()) {
+        if (error) *error = token.status() == DecodeStatus::DeadlineExceeded ? "Deadline exceeded" : "Cancelled";
+        return HalfPlanarImage();
+    }
+    if (corrupt.load()) {
+        if (error) *error = "Corrupt smart preview data";
+        return HalfPlanarImage();
+    }
+    return image;
+}
+
+} // namespace PixRaw